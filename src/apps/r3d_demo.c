@@ -0,0 +1,245 @@
+/* Exercises the r3d C API: renders a cube from caller-owned arrays, checks
+ * the results, and optionally renders an OBJ file to a PPM image, through a
+ * render cache when a cache directory is given.
+ *
+ *   r3d-demo [input.obj output.ppm [cache-dir]]
+ *
+ * Exits non-zero if any check fails. */
+#include "r3d.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+static void identity(float *m) {
+  memset(m, 0, 16 * sizeof(float));
+  m[0] = m[5] = m[10] = m[15] = 1.f;
+}
+
+/* Camera on +z at distance `dist`, looking at the origin */
+static void makeView(r3d_view *v, int w, int h, float dist) {
+  const float fovY = 60.f * 3.14159265f / 180.f;
+  const float zn = 0.05f, zf = 1000.f;
+  const float f = 1.f / tanf(fovY * 0.5f);
+
+  v->width = w;
+  v->height = h;
+  identity(v->model);
+  identity(v->view);
+  v->view[11] = -dist;
+  memset(v->proj, 0, sizeof(v->proj));
+  v->proj[0] = f * (float)h / (float)w;
+  v->proj[5] = f;
+  v->proj[10] = (zf + zn) / (zn - zf);
+  v->proj[11] = 2.f * zf * zn / (zn - zf);
+  v->proj[14] = -1.f;
+  v->near_z = zn;
+}
+
+static void testCube(r3d_context *ctx) {
+  static const float xyz[] = {-1, -1, -1, 1, -1, -1, 1, 1, -1, -1, 1, -1,
+                              -1, -1, 1,  1, -1, 1,  1, 1, 1,  -1, 1, 1};
+  static const int32_t edges[] = {0, 1, 1, 2, 2, 3, 3, 0, 4, 5, 5, 6,
+                                  6, 7, 7, 4, 0, 4, 1, 5, 2, 6, 3, 7};
+  static const int32_t badEdges[] = {0, 8};
+  const uint8_t white[3] = {255, 255, 255};
+  r3d_mesh *mesh = NULL, *bad = NULL;
+  r3d_mesh_info info;
+  r3d_view view;
+  r3d_line lines[16];
+  float x0[16], y0[16], x1[16], y1[16];
+  r3d_stats stats;
+  r3d_memory_info memory;
+  r3d_cache *cache = NULL;
+  char key[R3D_KEY_SIZE], key2[R3D_KEY_SIZE];
+  size_t count = 0, lit = 0, i;
+  uint8_t *pixels;
+
+  CHECK(r3d_mesh_create(xyz, 8, badEdges, 1, &bad) ==
+        R3D_ERROR_INVALID_ARGUMENT);
+  CHECK(bad == NULL);
+
+  CHECK(r3d_mesh_create(xyz, 8, edges, 12, &mesh) == R3D_OK);
+  if (!mesh)
+    return;
+  CHECK(r3d_mesh_get_info(mesh, &info) == R3D_OK);
+  CHECK(info.vertex_count == 8 && info.edge_count == 12);
+  CHECK(info.bounds_min[0] == -1.f && info.bounds_max[2] == 1.f);
+
+  makeView(&view, 64, 48, 5.f);
+  CHECK(r3d_render_lines(ctx, mesh, &view, lines, 16, &count) == R3D_OK);
+  CHECK(count == 12);
+  for (i = 0; i < count; ++i)
+    CHECK(lines[i].x0 > 0.f && lines[i].x0 < 64.f && lines[i].y0 > 0.f &&
+          lines[i].y0 < 48.f);
+
+  count = 0;
+  CHECK(r3d_render_lines(ctx, mesh, &view, lines, 4, &count) ==
+        R3D_ERROR_BUFFER_TOO_SMALL);
+  CHECK(count == 12);
+
+  /* The streams hold the same lines in the same order */
+  CHECK(r3d_render_line_streams(ctx, mesh, &view, x0, y0, x1, y1, 16,
+                                &count) == R3D_OK);
+  CHECK(count == 12);
+  for (i = 0; i < count; ++i)
+    CHECK(x0[i] == lines[i].x0 && y0[i] == lines[i].y0 &&
+          x1[i] == lines[i].x1 && y1[i] == lines[i].y1);
+  CHECK(r3d_render_line_streams(ctx, mesh, &view, x0, y0, x1, y1, 4,
+                                &count) == R3D_ERROR_BUFFER_TOO_SMALL);
+  CHECK(count == 12);
+
+  /* Negative distance puts the cube behind the camera: all edges clip away */
+  makeView(&view, 64, 48, -2.f);
+  CHECK(r3d_render_lines(ctx, mesh, &view, lines, 16, &count) == R3D_OK);
+  CHECK(count == 0);
+
+  makeView(&view, 64, 48, 5.f);
+  pixels = (uint8_t *)calloc(64 * 48, 3);
+  CHECK(r3d_render_rgb(ctx, mesh, &view, pixels, 64 * 3, white) == R3D_OK);
+  for (i = 0; i < 64 * 48 * 3; ++i)
+    lit += pixels[i] == 255;
+  CHECK(lit > 0);
+  CHECK(r3d_render_rgb(ctx, mesh, &view, pixels, 10, white) ==
+        R3D_ERROR_INVALID_ARGUMENT);
+  free(pixels);
+
+  CHECK(r3d_context_get_stats(ctx, &stats) == R3D_OK);
+  CHECK(stats.edges_in == 12 && stats.lines_out == 12);
+
+  /* Borrowed arrays are not counted; the context holds its scratch */
+  CHECK(r3d_get_memory_info(mesh, ctx, &memory) == R3D_OK);
+  CHECK(memory.mesh_reserved == 0 && memory.scratch_reserved > 0);
+  CHECK(memory.scratch_used <= memory.scratch_reserved);
+
+  /* Keys follow the view and the caller's extra bytes, nothing else */
+  CHECK(r3d_render_key(mesh, &view, "rgb", 3, key) == R3D_OK);
+  CHECK(strlen(key) == R3D_KEY_SIZE - 1);
+  CHECK(r3d_render_key(mesh, &view, "rgb", 3, key2) == R3D_OK);
+  CHECK(strcmp(key, key2) == 0);
+  CHECK(r3d_render_key(mesh, &view, "png", 3, key2) == R3D_OK);
+  CHECK(strcmp(key, key2) != 0);
+  makeView(&view, 64, 48, 5.5f);
+  CHECK(r3d_render_key(mesh, &view, "rgb", 3, key2) == R3D_OK);
+  CHECK(strcmp(key, key2) != 0);
+
+  /* Nothing touches the disk until a put */
+  CHECK(r3d_cache_open("r3d-demo-cache-unused", 1 << 20, &cache) == R3D_OK);
+  CHECK(r3d_cache_get(cache, key, NULL, 0, &count) == R3D_ERROR_NOT_FOUND);
+  CHECK(r3d_cache_get(cache, "not-a-key", NULL, 0, &count) ==
+        R3D_ERROR_INVALID_ARGUMENT);
+  r3d_cache_free(cache);
+
+  r3d_mesh_free(mesh);
+}
+
+static int writePPM(const char *out, const uint8_t *pixels, int w, int h) {
+  FILE *f = fopen(out, "wb");
+  if (!f)
+    return 0;
+  fprintf(f, "P6\n%d %d\n255\n", w, h);
+  fwrite(pixels, 3, (size_t)w * h, f);
+  fclose(f);
+  return 1;
+}
+
+static int renderFile(r3d_context *ctx, const char *in, const char *out,
+                      const char *cacheDir) {
+  const int w = 1000, h = 800;
+  const uint8_t color[3] = {230, 230, 240};
+  const size_t bytes = (size_t)w * h * 3;
+  r3d_mesh *mesh = NULL;
+  r3d_cache *cache = NULL;
+  r3d_mesh_info info;
+  r3d_view view;
+  r3d_stats stats;
+  char key[R3D_KEY_SIZE];
+  size_t size = 0;
+  float cx, cy, cz, r = 0.f;
+  uint8_t *pixels;
+  int i, ok;
+  r3d_status st = r3d_mesh_load_obj(in, &mesh);
+
+  if (st != R3D_OK) {
+    fprintf(stderr, "%s: %s\n", in, r3d_status_string(st));
+    return 0;
+  }
+  r3d_mesh_get_info(mesh, &info);
+  cx = 0.5f * (info.bounds_min[0] + info.bounds_max[0]);
+  cy = 0.5f * (info.bounds_min[1] + info.bounds_max[1]);
+  cz = 0.5f * (info.bounds_min[2] + info.bounds_max[2]);
+  for (i = 0; i < 3; ++i)
+    r = fmaxf(r, 0.5f * (info.bounds_max[i] - info.bounds_min[i]));
+
+  /* Frame the bounds: move the model to the origin in front of the camera */
+  makeView(&view, w, h, 3.f * (r > 0.f ? r : 1.f));
+  view.model[3] = -cx;
+  view.model[7] = -cy;
+  view.model[11] = -cz;
+
+  pixels = (uint8_t *)malloc(bytes);
+  if (cacheDir &&
+      r3d_cache_open(cacheDir, (uint64_t)1 << 30, &cache) == R3D_OK &&
+      r3d_render_key(mesh, &view, color, sizeof(color), key) == R3D_OK &&
+      r3d_cache_get(cache, key, pixels, bytes, &size) == R3D_OK &&
+      size == bytes) {
+    r3d_mesh_free(mesh);
+    r3d_cache_free(cache);
+    ok = writePPM(out, pixels, w, h);
+    free(pixels);
+    if (ok)
+      printf("Wrote %s from cache entry %s\n", out, key);
+    return ok;
+  }
+
+  memset(pixels, 20, bytes);
+  st = r3d_render_rgb(ctx, mesh, &view, pixels, (size_t)w * 3, color);
+  r3d_context_get_stats(ctx, &stats);
+  r3d_mesh_free(mesh);
+  if (st == R3D_OK && cache)
+    CHECK(r3d_cache_put(cache, key, pixels, bytes) == R3D_OK);
+  r3d_cache_free(cache);
+  ok = st == R3D_OK && writePPM(out, pixels, w, h);
+  free(pixels);
+  if (!ok)
+    return 0;
+  printf("Wrote %s: %llu of %llu edges visible in %.2f ms\n", out,
+         (unsigned long long)stats.lines_out,
+         (unsigned long long)stats.edges_in, stats.render_ns / 1e6);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  r3d_context *ctx;
+
+  printf("r3d %u.%u.%u\n", r3d_version() >> 16, (r3d_version() >> 8) & 0xff,
+         r3d_version() & 0xff);
+  CHECK(r3d_version() >> 16 == R3D_VERSION_MAJOR);
+
+  ctx = r3d_context_create();
+  CHECK(ctx != NULL);
+  if (!ctx)
+    return 1;
+  testCube(ctx);
+  if ((argc == 3 || argc == 4) &&
+      !renderFile(ctx, argv[1], argv[2], argc == 4 ? argv[3] : NULL))
+    ++failures;
+  r3d_context_free(ctx);
+
+  if (failures)
+    fprintf(stderr, "%d check(s) failed\n", failures);
+  else
+    printf("All checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+#include "core/Framebuffer.h"
+#include "core/HugePages.h"
+#include "core/Renderer.h"
+#include "core/Math.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Micro-benchmarks for core data layouts. Each subcommand prints one line
+// per variant so runs can be diffed.
+
+static void usage(const char* exe) {
+  std::cerr << "Usage:\n  " << exe
+            << " tlb [--vertices N] [--edges N] [--reps N]\n  " << exe
+            << " raster [--size N] [--lines N] [--length L] [--reps N]\n  " << exe
+            << " streams [--lines N] [--reps N]\n";
+}
+
+// Counts data-TLB load misses of the calling thread where perf allows it.
+class TlbMissCounter {
+public:
+  TlbMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  ~TlbMissCounter() {
+#ifdef __linux__
+    if (fd >= 0) close(fd);
+#endif
+  }
+  bool available() const { return fd >= 0; }
+  void start() {
+#ifdef __linux__
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+  uint64_t stop() {
+    uint64_t n = 0;
+#ifdef __linux__
+    if (fd < 0) return 0;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &n, sizeof(n)) != ssize_t(sizeof(n))) n = 0;
+#endif
+    return n;
+  }
+
+private:
+  int fd = -1;
+};
+
+// The renderer's inner loop in miniature: random vertex gathers per edge.
+template <typename VertArray, typename EdgeArray>
+static void runGather(const char* label, const VertArray& verts, const EdgeArray& edges,
+                      int reps, TlbMissCounter& tlb) {
+  double best = 1e30;
+  uint64_t misses = 0;
+  volatile float sink = 0.f; // keeps the loop from being optimised away
+  for (int r = 0; r < reps; ++r) {
+    tlb.start();
+    auto t0 = std::chrono::steady_clock::now();
+    float acc = 0.f;
+    for (const auto& e : edges) {
+      Vec3f d = verts[e.first] - verts[e.second];
+      acc += dot(d, d);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    uint64_t m = tlb.stop();
+    if (ms < best) { best = ms; misses = m; }
+    sink += acc;
+  }
+  std::cout << label << ": " << best << " ms, "
+            << (best * 1e6 / double(edges.size())) << " ns/edge, dTLB misses ";
+  if (tlb.available()) std::cout << misses; else std::cout << "n/a";
+  std::cout << "\n";
+}
+
+static int benchTlb(int argc, char** argv) {
+  size_t nVerts = 8u << 20, nEdges = 16u << 20;
+  int reps = 3;
+  for (int i = 0; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--vertices" && i + 1 < argc) nVerts = std::stoul(argv[++i]);
+    else if (a == "--edges" && i + 1 < argc) nEdges = std::stoul(argv[++i]);
+    else if (a == "--reps" && i + 1 < argc) reps = std::stoi(argv[++i]);
+    else { std::cerr << "Unknown arg: " << a << "\n"; return 2; }
+  }
+
+  std::ifstream thp("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string thpMode;
+  if (thp) std::getline(thp, thpMode);
+  std::cout << "tlb: " << nVerts << " vertices ("
+            << (nVerts * sizeof(Vec3f) >> 20) << " MB), " << nEdges
+            << " random edges, THP: " << (thpMode.empty() ? "unknown" : thpMode) << "\n";
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick(0, int(nVerts) - 1);
+  std::uniform_real_distribution<float> coord(-1.f, 1.f);
+
+  std::vector<Vec3f> verts4k(nVerts);
+  std::vector<std::pair<int, int>> edges4k(nEdges);
+  for (auto& v : verts4k) v = { coord(rng), coord(rng), coord(rng) };
+  for (auto& e : edges4k) e = { pick(rng), pick(rng) };
+
+  LargeVector<Vec3f> vertsHuge(verts4k.begin(), verts4k.end());
+  LargeVector<std::pair<int, int>> edgesHuge(edges4k.begin(), edges4k.end());
+
+  TlbMissCounter tlb;
+  runGather("4K pages  ", verts4k, edges4k, reps, tlb);
+  runGather("huge pages", vertsHuge, edgesHuge, reps, tlb);
+  return 0;
+}
+
+struct Segment { int x0, y0, x1, y1; };
+
+// Lines of about `length` pixels at random positions; `steep` picks the
+// major axis (|dy| > |dx|), -1 mixes both with random directions.
+static std::vector<Segment> makeSegments(int size, size_t count, int length, int steep,
+                                         std::mt19937& rng) {
+  std::uniform_int_distribution<int> pos(0, size - 1), minor(-length / 4, length / 4);
+  std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+  std::vector<Segment> out(count);
+  for (auto& s : out) {
+    s.x0 = pos(rng); s.y0 = pos(rng);
+    int dx, dy;
+    if (steep < 0) {
+      float a = angle(rng);
+      dx = int(std::cos(a) * length); dy = int(std::sin(a) * length);
+    } else {
+      int major = (rng() & 1) ? length : -length;
+      dx = steep ? minor(rng) : major;
+      dy = steep ? major : minor(rng);
+    }
+    s.x1 = s.x0 + dx; s.y1 = s.y0 + dy;
+  }
+  return out;
+}
+
+static void runRaster(const char* label, const std::vector<Segment>& segs, int size,
+                      int reps) {
+  size_t pixels = 0;
+  for (const auto& s : segs)
+    forEachLinePixel(s.x0, s.y0, s.x1, s.y1, size, size, [&](int, int) { ++pixels; });
+
+  std::cout << label << ":";
+  for (PixelLayout layout : { PixelLayout::RowMajor, PixelLayout::Tiled8 }) {
+    Framebuffer fb(size, size, 0, 0, 0, layout);
+    const PixelView v = fb.view();
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (const auto& s : segs) drawLine(v, s.x0, s.y0, s.x1, s.y1, 255, 255, 255);
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+      if (ms < best) best = ms;
+    }
+    std::cout << (layout == PixelLayout::RowMajor ? "  row-major " : "  tiled8 ")
+              << best << " ms (" << (double(pixels) / best / 1e3) << " Mpixel/s)";
+  }
+  std::cout << "\n";
+}
+
+// Line drawing throughput per framebuffer layout for shallow, steep and
+// mixed lines, plus what converting a tiled image back to rows costs.
+static int benchRaster(int argc, char** argv) {
+  int size = 8192, length = 256, reps = 3;
+  size_t count = 200000;
+  for (int i = 0; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--size" && i + 1 < argc) size = std::stoi(argv[++i]);
+    else if (a == "--lines" && i + 1 < argc) count = std::stoul(argv[++i]);
+    else if (a == "--length" && i + 1 < argc) length = std::stoi(argv[++i]);
+    else if (a == "--reps" && i + 1 < argc) reps = std::stoi(argv[++i]);
+    else { std::cerr << "Unknown arg: " << a << "\n"; return 2; }
+  }
+  if (size < 1 || length < 1 || reps < 1) { std::cerr << "Bad size\n"; return 2; }
+
+  std::cout << "raster: " << size << "x" << size << " image ("
+            << (size_t(size) * size * 3 >> 20) << " MB), " << count << " lines of "
+            << length << " px\n";
+  std::mt19937 rng(42);
+  runRaster("shallow", makeSegments(size, count, length, 0, rng), size, reps);
+  runRaster("steep  ", makeSegments(size, count, length, 1, rng), size, reps);
+  runRaster("random ", makeSegments(size, count, length, -1, rng), size, reps);
+
+  Framebuffer fb(size, size, 0, 0, 0, PixelLayout::Tiled8);
+  std::vector<uint8_t> rows(size_t(size) * size * 3);
+  double best = 1e30;
+  for (int r = 0; r < reps; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    copyRows(fb.view(), 0, size, rows.data(), size_t(size) * 3);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (ms < best) best = ms;
+  }
+  std::cout << "detile : " << best << " ms ("
+            << (double(rows.size()) / best / 1e6) << " GB/s)\n";
+  return 0;
+}
+
+// Best of `reps` runs of fn, in ms
+template <typename Fn>
+static double bestOf(int reps, Fn&& fn) {
+  double best = 1e30;
+  for (int r = 0; r < reps; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (ms < best) best = ms;
+  }
+  return best;
+}
+
+// Two typical passes over renderer output, on interleaved lines and on
+// coordinate streams: counting lines of at least 2 px (length filtering)
+// and the bounding box of all endpoints (binning).
+static int benchStreams(int argc, char** argv) {
+  size_t count = 16u << 20;
+  int reps = 5;
+  for (int i = 0; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--lines" && i + 1 < argc) count = std::stoul(argv[++i]);
+    else if (a == "--reps" && i + 1 < argc) reps = std::stoi(argv[++i]);
+    else { std::cerr << "Unknown arg: " << a << "\n"; return 2; }
+  }
+  std::cout << "streams: " << count << " lines ("
+            << (count * sizeof(ScreenLine) >> 20) << " MB)\n";
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> pos(0.f, 4096.f), step(-3.f, 3.f);
+  std::vector<ScreenLine> aos(count);
+  for (auto& l : aos) {
+    l.a = { pos(rng), pos(rng) };
+    l.b = { l.a.x + step(rng), l.a.y + step(rng) };
+  }
+  const size_t padded = ScreenLines::padded(count);
+  LargeVector<float> storage(4 * padded, 0.f);
+  ScreenLines soa;
+  soa.ax = storage.data();
+  soa.ay = soa.ax + padded;
+  soa.bx = soa.ay + padded;
+  soa.by = soa.bx + padded;
+  soa.size = count;
+  for (size_t i = 0; i < count; ++i) {
+    soa.ax[i] = aos[i].a.x; soa.ay[i] = aos[i].a.y;
+    soa.bx[i] = aos[i].b.x; soa.by[i] = aos[i].b.y;
+  }
+
+  volatile float sink = 0.f;
+  const float minLen2 = 4.f;
+  size_t longA = 0, longS = 0;
+  double filterA = bestOf(reps, [&] {
+    size_t n = 0;
+    for (const auto& l : aos) {
+      float dx = l.b.x - l.a.x, dy = l.b.y - l.a.y;
+      n += dx * dx + dy * dy >= minLen2;
+    }
+    longA = n;
+  });
+  double filterS = bestOf(reps, [&] {
+    // Padding lines have length 0, so whole lanes need no tail
+    size_t n = 0;
+    for (size_t i = 0; i < padded; ++i) {
+      float dx = soa.bx[i] - soa.ax[i], dy = soa.by[i] - soa.ay[i];
+      n += dx * dx + dy * dy >= minLen2;
+    }
+    longS = n;
+  });
+  double boundsA = bestOf(reps, [&] {
+    float lo = 1e30f, hi = -1e30f;
+    for (const auto& l : aos) {
+      lo = std::min(lo, std::min(l.a.x, l.b.x));
+      hi = std::max(hi, std::max(l.a.x, l.b.x));
+    }
+    sink = sink + lo + hi;
+  });
+  double boundsS = bestOf(reps, [&] {
+    float lo = 1e30f, hi = -1e30f;
+    for (size_t i = 0; i < count; ++i) {
+      lo = std::min(lo, std::min(soa.ax[i], soa.bx[i]));
+      hi = std::max(hi, std::max(soa.ax[i], soa.bx[i]));
+    }
+    sink = sink + lo + hi;
+  });
+  if (longA != longS) { std::cerr << "Length filters disagree\n"; return 1; }
+  std::cout << "length filter: interleaved " << filterA << " ms, streams " << filterS
+            << " ms (" << longS << " lines kept)\n"
+            << "x bounds     : interleaved " << boundsA << " ms, streams " << boundsS << " ms\n";
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) { usage(argv[0]); return 1; }
+  std::string cmd = argv[1];
+  if (cmd == "tlb") return benchTlb(argc - 2, argv + 2);
+  if (cmd == "raster") return benchRaster(argc - 2, argv + 2);
+  if (cmd == "streams") return benchStreams(argc - 2, argv + 2);
+  usage(argv[0]);
+  return 1;
+}
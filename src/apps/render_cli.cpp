@@ -1,73 +1,230 @@
 #include "core/Camera.h"
+#include "core/Components.h"
+#include "core/ContentHash.h"
+#include "core/DiskCache.h"
+#include "core/Framebuffer.h"
+#include "core/Instancing.h"
 #include "core/Math.h"
+#include "core/MeshSegment.h"
+#include "core/MemoryReport.h"
 #include "core/ObjLoader.h"
+#include "core/Overdraw.h"
+#include "core/Panorama.h"
+#include "core/PngWriter.h"
 #include "core/Renderer.h"
+#include "core/SvgWriter.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifdef __unix__
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
 static void usage(const char* exe) {
   std::cerr << "Usage:\n  " << exe
-            << " input.obj output.ppm [--eye x y z] [--target x y z] [--fov deg]"
-               " [--size W H] [--ortho scale]\n";
+            << " input.obj|- output.(ppm|png|svg) [--eye x y z] [--target x y z] [--fov deg]"
+               " [--size W H] [--ortho scale] [--progress] [--instances N]"
+               " [--features] [--summary] [--overdraw]"
+               " [--stats] [--mem-report] [--cubemap S | --equirect]"
+               " [--deadline-ms N] [--processes N]"
+               " [--cache-dir DIR [--cache-mb N]]\n";
 }
 
-// simple RGB image
-struct Image {
-  int w = 0, h = 0;
-  std::vector<uint8_t> data; // size = w*h*3
-  Image(int W, int H, uint8_t r, uint8_t g, uint8_t b) : w(W), h(H), data(W*H*3) {
-    for (int i = 0; i < W*H; ++i) { data[3*i+0]=r; data[3*i+1]=g; data[3*i+2]=b; }
-  }
-  inline void put(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
-    if (x < 0 || y < 0 || x >= w || y >= h) return;
-    int idx = (y*w + x) * 3;
-    data[idx+0]=r; data[idx+1]=g; data[idx+2]=b;
-  }
+static bool isPng(const std::string& path) {
+  return path.size() > 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+}
+
+// PNG when the name ends in .png, PPM otherwise
+static bool saveImage(const std::string& path, const Framebuffer& img,
+                      bool compress = true) {
+  return isPng(path) ? savePNG(path, img, compress) : savePPM(path, img);
+}
+
+// Writing cost per byte of pixels, measured up to 6000x6000 with page faults
+// on fresh buffers included and rounded up: missing a deadline is worse
+// than drawing a little less
+const double kPpmNsPerByte = 2.0;
+const double kStoredPngNsPerByte = 5.0; // filtering and deflate skipped
+const double kPngNsPerByte = 16.0;
+
+static std::chrono::microseconds writeTime(int w, int h, double nsPerByte) {
+  return std::chrono::microseconds(
+      5000 + int64_t(double(w) * double(h) * 3.0 * nsPerByte / 1000.0));
+}
+
+// Copies a finished output file into the render cache
+static void storeInCache(DiskCache* cache, const std::string& name,
+                         const std::string& path) {
+  if (!cache) return;
+  std::ifstream f(path, std::ios::binary);
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)),
+                             std::istreambuf_iterator<char>());
+  if (f.bad() || bytes.empty()) return;
+  if (cache->write(name, bytes.data(), bytes.size()))
+    std::cout << "Cached as " << name << "\n";
+}
+
+#ifdef __unix__
+// What a worker reports back; the shared image holds one per worker, then
+// the pixels
+struct ShardResult {
+  RenderStats stats;
+  uint64_t peakResident = 0;
 };
 
-static bool savePPM(const std::string& path, const Image& img) {
-  std::ofstream f(path, std::ios::binary);
-  if (!f) return false;
-  f << "P6\n" << img.w << " " << img.h << "\n255\n";
-  f.write(reinterpret_cast<const char*>(img.data.data()), img.data.size());
-  return f.good();
+static size_t shardStatsBytes(int workers) {
+  return (size_t(workers) * sizeof(ShardResult) + 63) & ~size_t(63);
 }
 
-// integer Bresenham
-static void drawLine(Image& im, int x0, int y0, int x1, int y1,
-                     uint8_t r, uint8_t g, uint8_t b) {
-  auto plot = [&](int x, int y){ im.put(x, y, r, g, b); };
+// Worker side of --processes: draws shard k of n of the shared mesh into the
+// shared image and leaves its counters next to it
+static int renderShard(const RenderDesc& base, int k, int n,
+                       const std::string& meshName, const std::string& imageName) {
+  std::unique_ptr<MeshSegment> mesh = MeshSegment::open(meshName);
+  std::unique_ptr<SharedRegion> image = SharedRegion::open(imageName);
+  const size_t statsBytes = shardStatsBytes(n);
+  if (!mesh || !image ||
+      image->size() != statsBytes + size_t(base.width) * base.height * 3)
+    return 4;
+  RenderDesc desc = base;
+  desc.target = {image->data() + statsBytes, base.width, base.height,
+                 size_t(base.width) * 3};
+  ShardResult result;
+  desc.stats = &result.stats;
+  FrameArena arena;
+  renderLines(desc, meshShard(mesh->view(), size_t(k), size_t(n)), arena);
+  result.peakResident = peakResidentBytes();
+  std::memcpy(image->data() + size_t(k) * sizeof(ShardResult), &result,
+              sizeof(result));
+  return 0;
+}
 
-  bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
-  if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
-  if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+// Launcher side: one copy of the mesh in shared memory, N processes drawing
+// disjoint object ranges straight into one shared image. Lines all have the
+// same colour, so the result equals a single-process render.
+static bool runShards(int argc, char** argv, int workers, Mesh& mesh,
+                      Framebuffer& img, RenderStats& counters) {
+  const std::string tag = "/r3d-" + std::to_string(getpid());
+  std::unique_ptr<MeshSegment> segment = MeshSegment::create(tag + "-mesh", mesh);
+  if (!segment) return false;
+  mesh = Mesh{}; // the segment is now the only copy
+  const size_t statsBytes = shardStatsBytes(workers);
+  std::unique_ptr<SharedRegion> image =
+      SharedRegion::create(tag + "-image", statsBytes + img.data.size());
+  if (!image) return false;
+  std::memset(image->data(), 0, statsBytes);
+  std::memcpy(image->data() + statsBytes, img.data.data(), img.data.size());
 
-  int dx = x1 - x0;
-  int dy = std::abs(y1 - y0);
-  int err = dx / 2;
-  int ystep = (y0 < y1) ? 1 : -1;
-  int y = y0;
+  // Same arguments minus --processes, plus the worker's shard
+  std::vector<std::string> args;
+  for (int i = 0; i < argc; ++i) {
+    if (std::string(argv[i]) == "--processes") { ++i; continue; }
+    args.push_back(argv[i]);
+  }
+  // Split the cores between the workers
+  const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> env;
+  for (char** e = environ; *e; ++e)
+    if (std::strncmp(*e, "R3D_THREADS=", 12) != 0) env.push_back(*e);
+  env.push_back("R3D_THREADS=" + std::to_string(std::max(1u, hw / unsigned(workers))));
+  std::vector<char*> envp;
+  for (auto& e : env) envp.push_back(&e[0]);
+  envp.push_back(nullptr);
 
-  for (int x = x0; x <= x1; ++x) {
-    if (steep) plot(y, x); else plot(x, y);
-    err -= dy;
-    if (err < 0) { y += ystep; err += dx; }
+  std::cout << "Shared mesh: " << (segment->bytes() >> 20) << " MB in "
+            << segment->view().objectCount << " parts, " << workers
+            << " worker processes\n";
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<pid_t> pids;
+  for (int k = 0; k < workers; ++k) {
+    std::vector<std::string> a = args;
+    for (const std::string& x : {std::string("--shard"), std::to_string(k),
+                                 std::to_string(workers), segment->name(), image->name()})
+      a.push_back(x);
+    std::vector<char*> av;
+    for (auto& x : a) av.push_back(&x[0]);
+    av.push_back(nullptr);
+    pid_t pid;
+    if (posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, av.data(), envp.data()) != 0 &&
+        posix_spawn(&pid, argv[0], nullptr, nullptr, av.data(), envp.data()) != 0) {
+      std::cerr << "Failed to start worker " << k << "\n";
+      continue;
+    }
+    pids.push_back(pid);
   }
+  bool ok = int(pids.size()) == workers;
+  for (size_t k = 0; k < pids.size(); ++k) {
+    int status = 0;
+    if (waitpid(pids[k], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      std::cerr << "Worker " << k << " failed\n";
+      ok = false;
+    }
+  }
+  const double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  std::cout << "Rendered in " << ms << " ms\n";
+  if (!ok) return false;
+
+  for (int k = 0; k < workers; ++k) {
+    ShardResult r;
+    std::memcpy(&r, image->data() + size_t(k) * sizeof(ShardResult), sizeof(r));
+    counters += r.stats;
+    std::cout << "  worker " << k << ": " << r.stats.emitted << " lines, peak "
+              << (r.peakResident >> 20) << " MB resident (shared pages included)\n";
+  }
+  std::memcpy(img.data.data(), image->data() + statsBytes, img.data.size());
+  return true;
+}
+#else
+static int renderShard(const RenderDesc&, int, int, const std::string&,
+                       const std::string&) {
+  return 4;
+}
+
+static bool runShards(int, char**, int, Mesh&, Framebuffer&, RenderStats&) {
+  std::cerr << "--processes needs a POSIX system\n";
+  return false;
 }
+#endif
 
 int main(int argc, char** argv) {
+  const auto started = RenderClock::now();
   if (argc < 3) { usage(argv[0]); return 1; }
   std::string inPath = argv[1];
   std::string outPath = argv[2];
 
   CameraOrbit cam{};
   int W = 1000, H = 800;
+  bool progress = false;
+  size_t instances = 0;
+  bool featuresOnly = false;
+  bool summary = false;
+  bool overdraw = false;
+  bool stats = false;
+  bool memReport = false;
+  int cubemap = 0;
+  bool equirect = false;
+  double deadlineMs = 0; // 0: no deadline
+  int processes = 0;
+  int shard = -1, shards = 0; // worker of a --processes launcher
+  std::string shardMesh, shardImage;
+  std::string cacheDir;
+  size_t cacheMb = 1024;
 
   cam.target = {0,0,0};
   cam.perspective = true;
@@ -92,34 +249,269 @@ int main(int argc, char** argv) {
       W = std::stoi(argv[++i]); H = std::stoi(argv[++i]);
     } else if (a == "--ortho" && need(1)) {
       cam.perspective = false; cam.orthoScale = std::stof(argv[++i]);
+    } else if (a == "--progress") {
+      progress = true;
+    } else if (a == "--instances" && need(1)) {
+      instances = std::stoul(argv[++i]);
+    } else if (a == "--features") {
+      featuresOnly = true;
+    } else if (a == "--summary") {
+      summary = true;
+    } else if (a == "--overdraw") {
+      overdraw = true;
+    } else if (a == "--stats") {
+      stats = true;
+    } else if (a == "--mem-report") {
+      memReport = true;
+    } else if (a == "--cubemap" && need(1)) {
+      cubemap = std::stoi(argv[++i]);
+    } else if (a == "--equirect") {
+      equirect = true;
+    } else if (a == "--deadline-ms" && need(1)) {
+      deadlineMs = std::stod(argv[++i]);
+    } else if (a == "--processes" && need(1)) {
+      processes = std::stoi(argv[++i]);
+    } else if (a == "--cache-dir" && need(1)) {
+      cacheDir = argv[++i];
+    } else if (a == "--cache-mb" && need(1)) {
+      cacheMb = std::stoul(argv[++i]);
+    } else if (a == "--shard" && need(4)) {
+      shard = std::stoi(argv[++i]); shards = std::stoi(argv[++i]);
+      shardMesh = argv[++i]; shardImage = argv[++i];
     } else {
       std::cerr << "Unknown arg: " << a << "\n"; usage(argv[0]); return 2;
     }
   }
 
+  RenderDesc desc;
+  desc.width = W; desc.height = H;
+  desc.view = cam.view();
+  desc.proj = cam.projection(float(W) / float(H));
+  desc.nearZ = cam.znear;
+  if (featuresOnly) desc.mode = RenderMode::FeatureEdges;
+  const bool svg = outPath.size() > 4 &&
+                   outPath.compare(outPath.size() - 4, 4, ".svg") == 0;
+  if ((cubemap > 0 || equirect) && (svg || deadlineMs > 0 || processes > 0 ||
+                                    instances > 0 || overdraw || stats || memReport)) {
+    std::cerr << "--cubemap and --equirect write PPM or PNG images only, without"
+                 " --deadline-ms, --processes, --instances, --overdraw, --stats"
+                 " or --mem-report\n";
+    return 2;
+  }
+  if (shard >= 0) return renderShard(desc, shard, shards, shardMesh, shardImage);
+
+  // Repeated requests are answered from the cache without loading the mesh:
+  // the key is the file's content hash plus everything that shapes the output
+  std::unique_ptr<DiskCache> cache;
+  std::string cacheName;
+  if (!cacheDir.empty() && (deadlineMs > 0 || stats || summary || memReport || overdraw)) {
+    std::cerr << "--cache-dir is ignored with --deadline-ms, --stats, --summary,"
+                 " --mem-report and --overdraw\n";
+  } else if (!cacheDir.empty() && inPath == "-") {
+    // Hashing the input would consume it before the load
+    std::cerr << "--cache-dir is ignored when reading standard input\n";
+  } else if (!cacheDir.empty()) {
+    auto t0 = std::chrono::steady_clock::now();
+    Hash128 content;
+    if (!hashFile(inPath, content)) {
+      std::cerr << "Failed to read " << inPath << "\n"; return 3;
+    }
+    const size_t dot = outPath.find_last_of("./");
+    const std::string ext = dot != std::string::npos && outPath[dot] == '.'
+                                ? outPath.substr(dot) : ".ppm";
+    std::ostringstream variant;
+    variant << ext << " instances " << instances << " cubemap " << cubemap
+            << " equirect " << equirect;
+    const std::string key = renderKey(content, desc, variant.str()).hex();
+    cacheName = key.substr(0, 2) + "/" + key + ext;
+    cache.reset(new DiskCache(cacheDir, cacheMb << 20));
+    std::vector<uint8_t> bytes;
+    if (cache->read(cacheName, bytes)) {
+      std::ofstream f(outPath, std::ios::binary);
+      f.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+      if (!f.good()) {
+        std::cerr << "Failed to save " << outPath << "\n"; return 5;
+      }
+      const double ms = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - t0).count();
+      std::cout << "Wrote " << outPath << " from cache " << cacheName << " ("
+                << bytes.size() << " bytes, " << ms << " ms)\n";
+      return 0;
+    }
+  }
+
   Mesh mesh;
-  if (!loadOBJ(inPath, mesh)) return 3;
+  LoadOptions loadOpt;
+  if (progress) {
+    loadOpt.onProgress = [](const LoadProgress& p) {
+      std::cerr << "\rLoading: ";
+      if (p.totalBytes) std::cerr << (100 * p.bytesRead / p.totalBytes) << "% ";
+      std::cerr << p.vertices << " vertices, " << p.faces << " faces"
+                << (p.bytesRead == p.totalBytes ? "\n" : "") << std::flush;
+    };
+  }
+  if (!loadOBJ(inPath, mesh, loadOpt)) return 3;
+  if (summary) printMeshSummary(std::cout, mesh);
+
+  if (cubemap > 0 || equirect) {
+    // Everything around the camera position in one image; --target only
+    // places the eye through the orbit
+    PanoramaDesc pano;
+    pano.eye = cam.position();
+    pano.nearZ = cam.znear;
+    if (featuresOnly) pano.mode = RenderMode::FeatureEdges;
+    FrameArena arena;
+    auto t0 = std::chrono::steady_clock::now();
+    size_t lines;
+    Framebuffer img(cubemap > 0 ? 4 * cubemap : W, cubemap > 0 ? 3 * cubemap : H,
+                    18, 18, 20);
+    if (cubemap > 0) {
+      PixelView faces[6];
+      cubeCrossViews(img.view(), faces);
+      lines = renderCubeMap(pano, mesh, faces, arena);
+    } else {
+      lines = renderEquirect(pano, mesh, img.view(), arena);
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::cout << (cubemap > 0 ? "Cube map: " : "Equirect: ") << lines
+              << " lines in " << ms << " ms\n";
+    if (!saveImage(outPath, img)) {
+      std::cerr << "Failed to save " << outPath << "\n"; return 5;
+    }
+    std::cout << "Wrote " << outPath << " (" << img.w << "x"
+              << img.h << ")\n";
+    storeInCache(cache.get(), cacheName, outPath);
+    return 0;
+  }
+
+  Framebuffer img(W, H, 18, 18, 20);
+  if (processes > 0) {
+    if (instances > 0 || overdraw || svg || deadlineMs > 0) {
+      std::cerr << "--processes renders plain PPM images only\n"; return 2;
+    }
+    RenderStats counters;
+    if (!runShards(argc, argv, processes, mesh, img, counters)) return 4;
+    if (stats) printRenderStats(std::cout, counters);
+    if (!saveImage(outPath, img)) {
+      std::cerr << "Failed to save " << outPath << "\n"; return 5;
+    }
+    std::cout << "Wrote " << outPath << " (" << W << "x" << H << ")\n";
+    storeInCache(cache.get(), cacheName, outPath);
+    return 0;
+  }
 
-  Renderer renderer(W, H);
-  Mat4 view = cam.view();
-  Mat4 proj = cam.projection(float(W) / float(H));
+  // SVG output gets the lines as vectors; the overdraw heatmap replaces
+  // them. Either way nothing is drawn directly.
+  if (!overdraw && !svg) desc.target = img.view();
 
-  auto lines = renderer.buildProjectedLines(view, proj, mesh, cam.znear);
+  RenderStats counters;
+  desc.stats = &counters;
 
-  // draw
-  Image img(W, H, 18, 18, 20);
-  const uint8_t R = 230, G = 230, B = 240;
-  for (const auto& ln : lines) {
-    int x0 = static_cast<int>(std::lround(ln.a.x));
-    int y0 = static_cast<int>(std::lround(ln.a.y));
-    int x1 = static_cast<int>(std::lround(ln.b.x));
-    int y1 = static_cast<int>(std::lround(ln.b.y));
-    drawLine(img, x0, y0, x1, y1, R, G, B);
+  // The budget runs from process start, so loading and the framebuffer's
+  // allocation and fill above are already paid; writing the output gets
+  // writeTime(). SVG output is trimmed to fit instead (below).
+  RenderClock::time_point finishBy = kNoDeadline;
+  if (deadlineMs > 0) {
+    finishBy = started + std::chrono::microseconds(int64_t(deadlineMs * 1000));
+    // PNG reserves the uncompressed cost and compresses if time is left
+    desc.deadline = finishBy - writeTime(W, H, svg ? 0.0 : isPng(outPath)
+                                                 ? kStoredPngNsPerByte
+                                                 : kPpmNsPerByte);
   }
 
-  if (!savePPM(outPath, img)) {
+  FrameArena arena;
+  MemoryReport memory;
+  OverdrawMap writes;
+  if (overdraw) writes.resize(W, H);
+  ArenaSpan<ScreenLine> drawn;
+  if (instances > 0) {
+    // A fleet of copies sharing the one mesh, culled through the instance BVH
+    MeshHandle shared = SharedMesh::freeze(std::move(mesh));
+    InstanceSet fleet(shared, gridTransforms(shared->bounds(), instances));
+    ArenaSpan<VisibleInstance> visible =
+        fleet.cull(desc, InstanceCullOptions{}, arena);
+    InstanceLines lines = renderInstances(desc, fleet, visible, arena);
+    std::cout << "Instances: " << visible.size << " of " << fleet.size()
+              << " visible, " << lines.full.size << " edge lines, "
+              << lines.boxes.size << " box lines\n";
+    if (overdraw) {
+      writes.addLines(lines.full);
+      writes.addLines(lines.boxes);
+    }
+    if (memReport) {
+      addMesh(memory, *shared);
+      addInstances(memory, fleet);
+    }
+    if (svg) {
+      drawn = arena.local().span<ScreenLine>(lines.full.size + lines.boxes.size);
+      std::copy(lines.boxes.begin(), lines.boxes.end(),
+                std::copy(lines.full.begin(), lines.full.end(), drawn.data));
+    }
+  } else {
+    drawn = renderLines(desc, mesh, arena);
+    if (overdraw) writes.addLines(drawn);
+    if (memReport) addMesh(memory, mesh);
+  }
+  if (stats) printRenderStats(std::cout, counters);
+  if (overdraw) {
+    drawOverdrawHeatmap(writes, img.view());
+    printOverdrawStats(std::cout, overdrawStats(writes));
+  }
+  if (memReport) {
+    addArena(memory, arena);
+    addRenderLines(memory, counters);
+    if (!svg) addFramebuffer(memory, img);
+    if (overdraw) memory.addVector("framebuffer", "overdraw counts", writes.counts);
+    memory.print(std::cout);
+  }
+
+  if (svg && deadlineMs > 0) {
+    // SVG output costs ~300 ns per line: keep the most important ones
+    const auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        finishBy - RenderClock::now()).count();
+    const size_t fit = left > 0 ? size_t(left / 300) : 0;
+    if (drawn.size > fit) {
+      counters.undrawn += drawn.size - fit;
+      drawn.size = fit;
+    }
+  }
+  auto reportDeadline = [&] {
+    if (deadlineMs <= 0) return;
+    const double ms = std::chrono::duration<double, std::milli>(
+        RenderClock::now() - started).count();
+    std::cout << "Deadline: " << ms << " of " << deadlineMs << " ms, "
+              << (100.0 * counters.detail()) << "% of detail drawn ("
+              << counters.deadlineSkipped << " edges skipped, "
+              << counters.undrawn << " lines undrawn)\n";
+  };
+
+  if (svg) {
+    auto t0 = std::chrono::steady_clock::now();
+    SvgStats svgStats;
+    if (!writeSVG(outPath, W, H, drawn.data, drawn.size, SvgOptions{}, &svgStats)) {
+      std::cerr << "Failed to save " << outPath << "\n"; return 5;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Wrote " << outPath << ": " << svgStats.segmentsOut << " of "
+              << svgStats.segmentsIn << " segments (" << svgStats.offscreen
+              << " off-screen, " << svgStats.tooShort << " sub-pixel, "
+              << svgStats.duplicates << " duplicate) in " << svgStats.polylines
+              << " polylines, " << svgStats.bytes << " bytes, " << ms << " ms\n";
+    reportDeadline();
+    storeInCache(cache.get(), cacheName, outPath);
+    return 0;
+  }
+  const bool compress = deadlineMs <= 0 ||
+                        RenderClock::now() + writeTime(W, H, kPngNsPerByte) <= finishBy;
+  if (!saveImage(outPath, img, compress)) {
     std::cerr << "Failed to save " << outPath << "\n"; return 5;
   }
-  std::cout << "Wrote " << outPath << " (" << W << "x" << H << ")\n";
+  std::cout << "Wrote " << outPath << " (" << W << "x" << H
+            << (compress || !isPng(outPath) ? "" : ", uncompressed to meet the deadline")
+            << ")\n";
+  reportDeadline();
+  storeInCache(cache.get(), cacheName, outPath);
   return 0;
 }
\ No newline at end of file
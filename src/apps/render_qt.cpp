@@ -11,33 +11,40 @@
 #include <QKeyEvent>
 #include <QVector>
 #include <QLineF>
+#include <QRectF>
+#include <QImage>
 #include <QString>
 
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <future>
+#include <memory>
+#include <new>
 #include <limits>
 #include <sstream>
+#include <string>
 #include <vector>
 #include <iostream>
 
 #include "core/Math.h"
+#include "core/MemoryReport.h"
 #include "core/Camera.h"
+#include "core/FrameArena.h"
+#include "core/Instancing.h"
+#include "core/AsyncLoad.h"
 #include "core/ObjLoader.h"
+#include "core/Renderer.h"
+#include "core/Overdraw.h"
+#include "core/SharedMesh.h"
+#include "core/ThreadPool.h"
+#include "core/Trace.h"
 
 // --- Helpers ---------------------------------------------------------------
 
-static void frameCameraToMesh(CameraOrbit& cam, const Mesh& mesh) {
-    if (mesh.vertices.empty()) return;
-
-    Vec3f mn{ std::numeric_limits<float>::infinity(),
-              std::numeric_limits<float>::infinity(),
-              std::numeric_limits<float>::infinity() };
-    Vec3f mx{ -mn.x, -mn.y, -mn.z };
-
-    for (const auto& v : mesh.vertices) {
-        mn.x = std::min(mn.x, v.x); mn.y = std::min(mn.y, v.y); mn.z = std::min(mn.z, v.z);
-        mx.x = std::max(mx.x, v.x); mx.y = std::max(mx.y, v.y); mx.z = std::max(mx.z, v.z);
-    }
+static void frameCameraToBounds(CameraOrbit& cam, const Bounds& b) {
+    if (b.empty()) return;
+    const Vec3f mn = b.min, mx = b.max;
 
     Vec3f center{ (mn.x + mx.x) * 0.5f, (mn.y + mx.y) * 0.5f, (mn.z + mx.z) * 0.5f };
     float ex = mx.x - mn.x, ey = mx.y - mn.y, ez = mx.z - mn.z;
@@ -53,6 +60,11 @@ static void frameCameraToMesh(CameraOrbit& cam, const Mesh& mesh) {
     cam.zfar       = 20000.0f;
 }
 
+// Bounds are computed once per mesh and cached on the shared handle.
+static void frameCameraToMesh(CameraOrbit& cam, const SharedMesh& mesh) {
+    frameCameraToBounds(cam, mesh.bounds());
+}
+
 static inline bool projectToScreen(const Vec3f& c, const Mat4& P, int W, int H, Vec2f& s) {
     Vec4f clip = mul(P, { c.x, c.y, c.z, 1.f });
     if (std::abs(clip.w) < 1e-6f) return false;
@@ -78,22 +90,66 @@ static inline bool clipNear(Vec3f& a, Vec3f& b, float znear) {
     return true;
 }
 
+// --- Impostors ------------------------------------------------------------
+
+// Sprite of one distant object, captured from direction `dir`.
+struct ImpostorSprite {
+    QImage image;
+    Vec3f  dir;              // unit vector from object centre towards the eye
+    float  pxRadius = 1.f;   // projected bounding radius at capture time
+    bool   perspective = true;
+};
+
+// Renders the edges of `obj` into a transparent sprite centred on `center`
+// (its projected bounds centre). Runs on a worker thread; the object lies
+// entirely in front of the near plane, so no clipping is needed.
+static ImpostorSprite renderImpostor(const Mesh& mesh, const MeshObject& obj,
+                                     const Mat4& V, const Mat4& P, int W, int H,
+                                     Vec2f center, float pxRadius, Vec3f dir,
+                                     bool perspective) {
+    ImpostorSprite out;
+    out.dir = dir;
+    out.pxRadius = std::max(pxRadius, 1.f);
+    out.perspective = perspective;
+
+    const int side = int(std::ceil(2.f * out.pxRadius)) + 4;
+    out.image = QImage(side, side, QImage::Format_ARGB32_Premultiplied);
+    out.image.fill(Qt::transparent);
+
+    const float ox = 0.5f * side - center.x, oy = 0.5f * side - center.y;
+    QVector<QLineF> lines;
+    lines.reserve(obj.edgeCount);
+    for (int i = obj.firstEdge; i < obj.firstEdge + obj.edgeCount; ++i) {
+        const auto& e = mesh.edges[i];
+        const Vec3f& va = mesh.vertices[e.first];
+        const Vec3f& vb = mesh.vertices[e.second];
+        Vec4f a4 = mul(V, { va.x, va.y, va.z, 1.f });
+        Vec4f b4 = mul(V, { vb.x, vb.y, vb.z, 1.f });
+        Vec2f sa, sb;
+        if (!projectToScreen({ a4.x, a4.y, a4.z }, P, W, H, sa)) continue;
+        if (!projectToScreen({ b4.x, b4.y, b4.z }, P, W, H, sb)) continue;
+        lines.push_back(QLineF(sa.x + ox, sa.y + oy, sb.x + ox, sb.y + oy));
+    }
+
+    QPainter p(&out.image);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    QPen pen(QColor(220, 220, 235));
+    pen.setCosmetic(true);
+    p.setPen(pen);
+    if (!lines.empty()) p.drawLines(lines);
+    return out;
+}
+
 // --- Viewer ---------------------------------------------------------------
 
 class Viewer : public QWidget {
 public:
-    explicit Viewer(const QString& objPath, QWidget* parent=nullptr) : QWidget(parent) {
+    explicit Viewer(std::vector<std::string> objPaths, QWidget* parent=nullptr)
+        : QWidget(parent), paths(std::move(objPaths)) {
         setWindowTitle("3D Renderer - Qt Viewer (near-clip fixed, adaptive LOD)");
         resize(1280, 800);
 
-        if (!loadOBJ(objPath.toStdString(), mesh)) {
-            std::cerr << "Failed to load OBJ " << objPath.toStdString() << "\n";
-        } else {
-            std::cerr << "Loaded OBJ with " << mesh.vertices.size()
-                      << " verts, " << mesh.edges.size() << " edges\n";
-        }
-
-        frameCameraToMesh(cam, mesh);
+        startLoad(0);
         setMouseTracking(true);
 
         timer = new QTimer(this);
@@ -104,7 +160,9 @@ public:
 
 protected:
     void paintEvent(QPaintEvent*) override {
+        R3D_PROBE(frame_start);
         const int W = width(), H = height();
+        pollLoad();
 
         // Keep near plane tiny and proportional to zoom to avoid popping edges.
         cam.znear = std::max(0.0005f * cam.radius, 0.001f);
@@ -115,60 +173,24 @@ protected:
         if (!clock.isValid()) clock.start();
         qint64 t0 = clock.nsecsElapsed();
 
-        // 1) world -> camera space for all verts
-        const size_t N = mesh.vertices.size();
-        camVerts.resize(N);
-        for (size_t i = 0; i < N; ++i) {
-            const auto& v = mesh.vertices[i];
-            Vec4f c4 = mul(V, { v.x, v.y, v.z, 1.f });
-            camVerts[i] = { c4.x, c4.y, c4.z };
-        }
-
-        // 2) Project verts that are in front of near plane
-        screens.resize(N);
-        valid.assign(N, 0);
-        for (size_t i = 0; i < N; ++i) {
-            const Vec3f c = camVerts[i];
-            if (-c.z >= cam.znear) {
-                Vec2f s;
-                if (projectToScreen(c, P, W, H, s)) { screens[i] = s; valid[i] = 1; }
-            }
-        }
-
-        // 3) Build line batch: ALWAYS clip to near plane, then project.
-        lines.clear();
-        lines.reserve(int(mesh.edges.size()));
-
-        const float lod2 = lodPx * lodPx;
-        const int   cap  = maxLinesCap;
-
-        for (const auto& e : mesh.edges) {
-            const size_t ia = (size_t)e.first;
-            const size_t ib = (size_t)e.second;
-
-            Vec2f sa, sb;
+        // 0) Distant objects come from cached sprites and skip steps 1-3
+        updateImpostors(V, P, W, H);
 
-            if (valid[ia] && valid[ib]) {
-                // Both pre-projected
-                sa = screens[ia]; sb = screens[ib];
-            } else {
-                // Try clipping against near plane, then project
-                Vec3f a = camVerts[ia], b = camVerts[ib];
-                if (!clipNear(a, b, cam.znear)) continue;
-                if (!projectToScreen(a, P, W, H, sa)) continue;
-                if (!projectToScreen(b, P, W, H, sb)) continue;
-            }
+        // Per-frame scratch comes from the arena: no heap traffic once warm
+        frameArena.reset();
 
-            float dx = sa.x - sb.x, dy = sa.y - sb.y;
-            if (fastMode && (dx*dx + dy*dy) < lod2) continue; // pixel-length LOD
+        frameStats = RenderStats{};
+        lodSkipped = 0;
+        int     nLines = 0;
+        QLineF* lines  = fleet ? buildFleetLines(V, P, W, H, nLines)
+                               : buildMeshLines(V, P, W, H, nLines);
 
-            lines.push_back(QLineF(sa.x, sa.y, sb.x, sb.y));
-            if ((int)lines.size() >= cap) break;
-        }
+        lastLines = nLines;
 
         // 4) Draw
         QPainter p(this);
         p.fillRect(rect(), QColor(18, 18, 20));
+        if (heatmap) drawHeatmap(p, lines, nLines, W, H);
         p.setRenderHint(QPainter::Antialiasing, antialias);
 
         // Axis gizmo (clipped to near)
@@ -191,7 +213,11 @@ protected:
         QPen pen(QColor(220, 220, 235));
         pen.setCosmetic(true);
         p.setPen(pen);
-        if (!lines.empty()) p.drawLines(lines);
+        if (nLines > 0 && !heatmap) p.drawLines(lines, nLines);
+
+        p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+        for (const auto& d : spriteDraws)
+            p.drawImage(d.rect, impostors[d.object].sprite.image);
 
         // HUD
         qint64 t1 = clock.nsecsElapsed();
@@ -200,25 +226,223 @@ protected:
 
         std::ostringstream hud;
         hud.setf(std::ios::fixed); hud.precision(1);
+        if (loading.valid()) {
+            LoadProgress lp = loading.progress();
+            hud << "Loading " << loading.path();
+            if (lp.totalBytes > 0) hud << " " << (100.0 * lp.bytesRead / lp.totalBytes) << "%";
+            hud << " (" << lp.vertices << " verts, " << lp.faces << " faces) | ";
+        }
         hud << (cam.perspective ? "Perspective" : "Orthographic")
             << " | FPS=" << (1000.0 / std::max(0.001, smoothedMs))
             << " | radius=" << cam.radius
             << " | fov=" << (cam.fovY * 180.0 / 3.14159265)
-            << " | edges=" << mesh.edges.size()
-            << " | drawn=" << lines.size()
+            << " | edges=" << mesh->edges.size()
+            << " | drawn=" << nLines;
+        if (fleet)
+            hud << " | FLEET=" << fleetVisible << "/" << fleet->size();
+        if (heatmap)
+            hud << " | HEAT=" << overdrawNow.writesPerPixel() << "/px, "
+                << (100.0 * overdrawNow.redundant()) << "% redundant";
+        hud << " | IMP=" << (impostorsOn ? "on" : "off")
+            << " (" << spriteDraws.size() << "/" << mesh->objects.size() << ")"
             << " | AA=" << (antialias ? "on" : "off")
-            << " | FAST=" << (fastMode ? "on" : "off")
+            << " | FAST=" << (fastMode ? (featureOnly ? "features" : "on") : "off")
             << " | LOD=" << lodPx << "px"
             << " | cap=" << maxLinesCap
             << " | target=" << targetFps << "fps";
 
+        // Pipeline counters of this frame's lines
+        std::ostringstream counters;
+        counters << "edges in=" << frameStats.processed
+                 << " | near rejected=" << frameStats.rejected
+                 << " clipped=" << frameStats.nearClipped
+                 << " | failed=" << frameStats.projectFailed
+                 << " | LOD skipped=" << lodSkipped
+                 << " | culled=" << frameStats.frustumCulled
+                 << " | out=" << frameStats.emitted;
+
         p.setPen(QColor(180, 180, 200));
         p.drawText(10, 20, QString::fromStdString(hud.str()));
+        p.drawText(10, 38, QString::fromStdString(counters.str()));
+        if (heatmap) drawOverdrawHistogram(p, H);
 
         // 5) Adapt LOD to hold target FPS
         const double goal = 1000.0 / double(targetFps);
         if (smoothedMs > goal * 1.05 && lodPx < 5.0f)      lodPx *= 1.10f; // slower -> increase LOD
         else if (smoothedMs < goal * 0.80 && lodPx > 0.25f) lodPx *= 0.90f; // faster -> decrease LOD
+
+        // Draw only feature edges while drawing all of them would miss the
+        // target; the estimate uses the measured cost per line, so it does
+        // not flip back just because feature-only frames are fast.
+        if (!fleet && nLines > 0) {
+            const size_t all = mesh->edges.size();
+            const double fullMs = smoothedMs / double(nLines) * double(all);
+            if (!fastMode || !mesh->classified())  featureOnly = false;
+            else if (fullMs > goal * 1.05)          featureOnly = true;
+            else if (fullMs < goal * 0.80)          featureOnly = false;
+        }
+        R3D_PROBE2(frame_end, nLines, clock.nsecsElapsed() - t0);
+    }
+
+    // 'H': shows how often the rasterizer would write each pixel for this
+    // frame's lines instead of the lines themselves.
+    void drawHeatmap(QPainter& p, const QLineF* lines, int nLines, int W, int H) {
+        if (overdraw.w != W || overdraw.h != H) overdraw.resize(W, H);
+        else                                    overdraw.clear();
+        for (int i = 0; i < nLines; ++i)
+            overdraw.addLine({ float(lines[i].x1()), float(lines[i].y1()) },
+                             { float(lines[i].x2()), float(lines[i].y2()) });
+        overdrawNow = overdrawStats(overdraw);
+
+        if (heatImage.width() != W || heatImage.height() != H)
+            heatImage = QImage(W, H, QImage::Format_RGB888);
+        heatImage.fill(QColor(18, 18, 20));
+        PixelView view{ heatImage.bits(), W, H, size_t(heatImage.bytesPerLine()) };
+        drawOverdrawHeatmap(overdraw, view);
+        p.drawImage(0, 0, heatImage);
+    }
+
+    // Share of covered pixels per write-count bucket, bottom left
+    void drawOverdrawHistogram(QPainter& p, int H) {
+        const int barW = 44, maxH = 90, x0 = 10, base = H - 24;
+        p.fillRect(x0 - 6, base - maxH - 22, OverdrawStats::kBuckets * barW + 8,
+                   maxH + 44, QColor(0, 0, 0, 160));
+        for (int b = 0; b < OverdrawStats::kBuckets; ++b) {
+            const double share = overdrawNow.covered
+                ? double(overdrawNow.histogram[b]) / double(overdrawNow.covered) : 0.0;
+            uint8_t c[3];
+            overdrawColor(uint32_t(1) << b, c);
+            const int h = int(std::lround(share * maxH));
+            const int x = x0 + b * barW;
+            p.fillRect(x, base - h, barW - 6, h, QColor(c[0], c[1], c[2]));
+            p.setPen(QColor(180, 180, 200));
+            p.drawText(x, base + 14, OverdrawStats::bucketLabel(b));
+            p.drawText(x, base - h - 4, QString::number(100.0 * share, 'f', 0) + "%");
+        }
+    }
+
+    // Steps 1-3 for the single mesh: transform each vertex once, then clip
+    // and project the edges. Lines come from the frame arena.
+    QLineF* buildMeshLines(const Mat4& V, const Mat4& P, int W, int H, int& nLines) {
+        FrameArena::Local& scratch = frameArena.local();
+
+        // 1) world -> camera space for all verts
+        const size_t N = mesh->vertices.size();
+        Vec3f*   camVerts = scratch.alloc<Vec3f>(N);
+        Vec2f*   screens  = scratch.alloc<Vec2f>(N);
+        uint8_t* valid    = scratch.alloc<uint8_t>(N);
+        auto transformVerts = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const auto& v = mesh->vertices[i];
+                Vec4f c4 = mul(V, { v.x, v.y, v.z, 1.f });
+                camVerts[i] = { c4.x, c4.y, c4.z };
+            }
+
+            // 2) Project verts that are in front of near plane
+            for (size_t i = begin; i < end; ++i) {
+                const Vec3f c = camVerts[i];
+                Vec2f s;
+                valid[i] = -c.z >= cam.znear && projectToScreen(c, P, W, H, s);
+                if (valid[i]) screens[i] = s;
+            }
+        };
+        if (mesh->objects.empty()) {
+            parallelFor(0, N, 8192, transformVerts);
+        } else {
+            for (size_t k = 0; k < mesh->objects.size(); ++k)
+                if (!spriteObject[k])
+                    parallelFor(size_t(mesh->objects[k].firstVertex),
+                                size_t(mesh->objects[k].endVertex), 8192, transformVerts);
+        }
+
+        // 3) Build line batch: ALWAYS clip to near plane, then project.
+        const float lod2 = lodPx * lodPx;
+        const int   cap  = int(std::min(mesh->edges.size(), size_t(maxLinesCap)));
+        QLineF*     lines  = scratch.alloc<QLineF>(size_t(cap));
+        lineCap = size_t(cap);
+        nLines = 0;
+
+        auto emitEdge = [&](const std::pair<int, int>& e) {
+            const size_t ia = (size_t)e.first;
+            const size_t ib = (size_t)e.second;
+
+            Vec2f sa, sb;
+            ++frameStats.processed;
+
+            if (valid[ia] && valid[ib]) {
+                // Both pre-projected
+                sa = screens[ia]; sb = screens[ib];
+            } else {
+                // Try clipping against near plane, then project
+                Vec3f a = camVerts[ia], b = camVerts[ib];
+                const bool clipped = -a.z < cam.znear || -b.z < cam.znear;
+                if (!clipNear(a, b, cam.znear)) { ++frameStats.rejected; return true; }
+                if (clipped) ++frameStats.nearClipped;
+                if (!projectToScreen(a, P, W, H, sa) || !projectToScreen(b, P, W, H, sb)) {
+                    ++frameStats.projectFailed;
+                    return true;
+                }
+            }
+
+            float dx = sa.x - sb.x, dy = sa.y - sb.y;
+            if (fastMode && (dx*dx + dy*dy) < lod2) { ++lodSkipped; return true; } // pixel-length LOD
+
+            new (&lines[nLines++]) QLineF(sa.x, sa.y, sb.x, sb.y);
+            ++frameStats.emitted;
+            return nLines < cap;
+        };
+        // Over budget, fast mode falls back to the precomputed feature edges
+        const auto& features = mesh->featureEdges;
+        if (mesh->objects.empty()) {
+            if (featureOnly) {
+                for (uint32_t i : features)
+                    if (!emitEdge(mesh->edges[i])) break;
+            } else {
+                for (const auto& e : mesh->edges)
+                    if (!emitEdge(e)) break;
+            }
+        } else {
+            bool full = false;
+            for (size_t k = 0; k < mesh->objects.size() && !full; ++k) {
+                if (spriteObject[k]) continue;
+                const MeshObject& obj = mesh->objects[k];
+                const uint32_t first = uint32_t(obj.firstEdge);
+                const uint32_t end   = uint32_t(obj.firstEdge + obj.edgeCount);
+                if (featureOnly) {
+                    auto it = std::lower_bound(features.begin(), features.end(), first);
+                    for (; it != features.end() && *it < end; ++it)
+                        if (!emitEdge(mesh->edges[*it])) { full = true; break; }
+                } else {
+                    for (uint32_t i = first; i < end; ++i)
+                        if (!emitEdge(mesh->edges[i])) { full = true; break; }
+                }
+            }
+        }
+        return lines;
+    }
+
+    // Fleet view: copies of the mesh culled through the instance BVH; close
+    // copies draw every edge, far ones their bounding box.
+    QLineF* buildFleetLines(const Mat4& V, const Mat4& P, int W, int H, int& nLines) {
+        RenderDesc desc;
+        desc.width = W; desc.height = H;
+        desc.view = V; desc.proj = P;
+        desc.nearZ = cam.znear;
+        desc.stats = &frameStats;
+        ArenaSpan<VisibleInstance> visible = fleet->cull(desc, InstanceCullOptions{}, frameArena);
+        InstanceLines il = renderInstances(desc, *fleet, visible, frameArena);
+        fleetVisible = visible.size;
+
+        const size_t cap = std::min(il.full.size + il.boxes.size, size_t(maxLinesCap));
+        QLineF* lines = frameArena.local().alloc<QLineF>(cap);
+        lineCap = cap;
+        nLines = 0;
+        for (const ArenaSpan<ScreenLine>* part : { &il.boxes, &il.full })
+            for (const ScreenLine& ln : *part) {
+                if (size_t(nLines) == cap) return lines;
+                new (&lines[nLines++]) QLineF(ln.a.x, ln.a.y, ln.b.x, ln.b.y);
+            }
+        return lines;
     }
 
     void wheelEvent(QWheelEvent* e) override {
@@ -263,21 +487,179 @@ protected:
     void keyPressEvent(QKeyEvent* e) override {
         if (e->key() == Qt::Key_Escape) close();
         if (e->key() == Qt::Key_O) { cam.perspective = !cam.perspective; update(); }
-        if (e->key() == Qt::Key_R) { cam = CameraOrbit{}; frameCameraToMesh(cam, mesh); update(); }
+        if (e->key() == Qt::Key_R) {
+            cam = CameraOrbit{};
+            if (fleet) frameCameraToBounds(cam, fleet->bounds());
+            else       frameCameraToMesh(cam, *mesh);
+            update();
+        }
         if (e->key() == Qt::Key_A) { antialias = !antialias; update(); }
         if (e->key() == Qt::Key_F) { fastMode  = !fastMode;  update(); }
         if (e->key() == Qt::Key_T) { targetFps = (targetFps == 30 ? 60 : 30); update(); }
+        if (e->key() == Qt::Key_I) { impostorsOn = !impostorsOn; update(); }
+        if (e->key() == Qt::Key_G) { setFleet(!fleet); update(); }
+        if (e->key() == Qt::Key_H) { heatmap = !heatmap; update(); }
+        if (e->key() == Qt::Key_M) printMemoryReport();
+        if (e->key() == Qt::Key_N && paths.size() > 1) { startLoad((pathIndex + 1) % paths.size()); update(); }
         QWidget::keyPressEvent(e);
     }
 
+    // 'M': memory held by the viewer, by subsystem, on stdout
+    void printMemoryReport() const {
+        MemoryReport report;
+        addMesh(report, *mesh);
+        if (fleet) addInstances(report, *fleet);
+        addArena(report, frameArena);
+        report.add("scratch", "line batch", size_t(lastLines) * sizeof(QLineF),
+                   lineCap * sizeof(QLineF), true);
+        report.add("scratch", "impostor flags", spriteObject.size(), spriteObject.capacity());
+        size_t sprites = 0, spriteCount = 0;
+        for (const auto& imp : impostors)
+            if (imp.valid) {
+                sprites += size_t(imp.sprite.image.sizeInBytes());
+                ++spriteCount;
+            }
+        report.add("caches", "impostor sprites (" + std::to_string(spriteCount) + ")",
+                   sprites, sprites);
+        report.add("framebuffer", "heatmap image", size_t(heatImage.sizeInBytes()),
+                   size_t(heatImage.sizeInBytes()));
+        report.addVector("framebuffer", "overdraw counts", overdraw.counts);
+        std::cout << "Memory report:\n";
+        report.print(std::cout);
+    }
+
+    // Starts loading paths[i] in the background; a load still in flight is
+    // cancelled. The current mesh stays on screen until the new one is ready.
+    void startLoad(size_t i) {
+        pathIndex = i;
+        loading = loadOBJAsync(paths[i]);
+    }
+
+    void pollLoad() {
+        if (!loading.ready()) return;
+        MeshLoadHandle::MeshPtr loaded;
+        try {
+            loaded = loading.future().get();
+        } catch (const std::exception& ex) {
+            std::cerr << "Failed to load OBJ " << loading.path() << ": " << ex.what() << "\n";
+        }
+        if (!loaded) {
+            std::cerr << "Failed to load OBJ " << loading.path() << "\n";
+        } else {
+            std::cerr << "Loaded OBJ with " << loaded->vertices.size()
+                      << " verts, " << loaded->edges.size() << " edges\n";
+            // Sprite jobs for the old mesh keep their own reference to it
+            mesh = std::move(loaded);
+            impostors.clear();
+            impostors.resize(mesh->objects.size());
+            cam = CameraOrbit{};
+            frameCameraToMesh(cam, *mesh);
+            if (fleet) setFleet(true);
+        }
+        loading = MeshLoadHandle{};
+    }
+
+    // Replaces the single mesh by a grid of fleetSize copies of it, or back.
+    void setFleet(bool on) {
+        fleet.reset();
+        cam = CameraOrbit{};
+        if (on) {
+            fleet = std::make_unique<InstanceSet>(mesh, gridTransforms(mesh->bounds(), fleetSize));
+            frameCameraToBounds(cam, fleet->bounds());
+        } else {
+            frameCameraToMesh(cam, *mesh);
+        }
+    }
+
+    // Picks the objects drawn from sprites this frame (spriteObject,
+    // spriteDraws) and schedules sprites whose view error grew too large.
+    void updateImpostors(const Mat4& V, const Mat4& P, int W, int H) {
+        spriteObject.assign(mesh->objects.size(), 0);
+        spriteDraws.clear();
+
+        int inFlight = 0;
+        for (auto& imp : impostors) {
+            if (!imp.pending.valid()) continue;
+            if (imp.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                imp.sprite = imp.pending.get();
+                imp.valid = true;
+            } else {
+                ++inFlight;
+            }
+        }
+        if (!impostorsOn || fleet) return;
+
+        const Vec3f eye = cam.position();
+        const Vec3f viewDir = normalize(eye - cam.target);
+        for (size_t k = 0; k < mesh->objects.size(); ++k) {
+            const MeshObject& obj = mesh->objects[k];
+            if (obj.edgeCount < impostorMinEdges) continue;
+
+            const Vec3f c = obj.bounds.center();
+            const float r = obj.bounds.radius();
+            Vec4f c4 = mul(V, { c.x, c.y, c.z, 1.f });
+            const float depth = -c4.z;
+            if (depth - r < 4.f * cam.znear) continue; // near or straddling the eye
+
+            const float pxR = r * P.m[1][1] * 0.5f * float(H) / (cam.perspective ? depth : 1.f);
+            if (pxR > impostorMaxPx) continue; // close enough to need real edges
+
+            Vec2f sc;
+            if (!projectToScreen({ c4.x, c4.y, c4.z }, P, W, H, sc)) continue;
+
+            // Perspective sprites depend on where the eye sits relative to the
+            // object; orthographic ones only on the viewing direction.
+            const Vec3f dir = cam.perspective ? normalize(eye - c) : viewDir;
+            Impostor& imp = impostors[k];
+            float err = std::numeric_limits<float>::infinity();
+            if (imp.valid && imp.sprite.perspective == cam.perspective)
+                err = std::acos(std::max(-1.f, std::min(1.f, dot(dir, imp.sprite.dir))));
+
+            if (err > impostorMaxErr && !imp.pending.valid() && inFlight < maxImpostorJobs) {
+                ++inFlight;
+                const bool persp = cam.perspective;
+                auto promise = std::make_shared<std::promise<ImpostorSprite>>();
+                imp.pending = promise->get_future();
+                impostorJobs.run([m = mesh, promise, k, V, P, W, H, sc, pxR, dir, persp] {
+                    promise->set_value(renderImpostor(*m, m->objects[k], V, P, W, H, sc, pxR, dir, persp));
+                });
+            }
+
+            // A slightly stale sprite is kept on screen while its replacement renders
+            if (err > 4.f * impostorMaxErr) continue;
+            spriteObject[k] = 1;
+            const float side = float(imp.sprite.image.width()) * (pxR / imp.sprite.pxRadius);
+            spriteDraws.push_back({ int(k), QRectF(sc.x - 0.5f * side, sc.y - 0.5f * side, side, side) });
+        }
+    }
+
 private:
-    Mesh        mesh;
+    struct Impostor {
+        ImpostorSprite               sprite;
+        bool                         valid = false;
+        std::future<ImpostorSprite>  pending; // regeneration in flight on the pool
+    };
+    struct SpriteDraw {
+        int    object;
+        QRectF rect;
+    };
+
+    std::vector<std::string>    paths;  // cycled with 'N'
+    size_t                      pathIndex = 0;
+    MeshLoadHandle              loading;
+    MeshHandle                  mesh = SharedMesh::freeze(Mesh{});
     CameraOrbit cam;
 
-    std::vector<Vec3f>   camVerts;
-    std::vector<Vec2f>   screens;
-    std::vector<uint8_t> valid;
-    QVector<QLineF>      lines;
+    TaskGroup               impostorJobs;
+    std::vector<Impostor>   impostors;    // one per mesh object
+    std::vector<uint8_t>    spriteObject; // per object: drawn from its sprite this frame
+    std::vector<SpriteDraw> spriteDraws;
+
+    FrameArena frameArena; // per-frame scratch: camera-space verts, screen verts, lines
+
+    std::unique_ptr<InstanceSet> fleet;  // 'G': copies of the mesh, null when off
+    size_t                       fleetSize = 1024;
+    size_t                       fleetVisible = 0;
 
     bool    L=false, R=false;
     QPoint  last;
@@ -288,8 +670,28 @@ private:
     bool  antialias   = false;
     bool  fastMode    = true; // pixel-length LOD on/off
     float lodPx       = 1.5f; // LOD threshold in pixels
+    bool  featureOnly = false; // fast mode over budget: feature edges only
+
+    RenderStats frameStats;     // counters of the last frame's lines
+    uint64_t    lodSkipped = 0; // edges under the pixel-length LOD threshold
+    int         lastLines = 0;  // lines drawn last frame...
+    size_t      lineCap = 0;    // ...out of a batch of this many
+
+    // Overdraw heatmap, toggled with 'H'
+    bool          heatmap = false;
+    OverdrawMap   overdraw;
+    OverdrawStats overdrawNow;
+    QImage        heatImage;
     int   maxLinesCap = 180000; // hard ceiling for safety
 
+    // Impostors: objects whose bounds project below impostorMaxPx are drawn
+    // from sprites, re-rendered once the view angle drifts past impostorMaxErr.
+    bool  impostorsOn      = true;  // toggle with 'I'
+    float impostorMaxPx    = 96.f;  // projected bounding radius, pixels
+    float impostorMaxErr   = 0.035f; // radians (~2 degrees)
+    int   impostorMinEdges = 500;   // smaller objects are cheaper drawn directly
+    int   maxImpostorJobs  = 4;     // concurrent sprite renders
+
     QElapsedTimer clock;
     double        smoothedMs = 33.0;
 };
@@ -298,11 +700,17 @@ private:
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " path/to/model.obj\n";
+        std::cerr << "Usage: " << argv[0] << " path/to/model.obj [more.obj ...]\n";
         return 1;
     }
+    // The GUI thread joins parallelFor itself and Qt runs its own thread
+    // pool; leave a hardware thread for those instead of oversubscribing.
+    ThreadPool::Options poolOpt;
+    poolOpt.reserveThreads = 1;
+    ThreadPool::configureShared(poolOpt);
+
     QApplication app(argc, argv);
-    Viewer w(QString::fromLocal8Bit(argv[1]));
+    Viewer w(std::vector<std::string>(argv + 1, argv + argc));
     w.show();
     return app.exec();
 }
\ No newline at end of file
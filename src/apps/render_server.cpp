@@ -0,0 +1,370 @@
+#include "core/Camera.h"
+#include "core/ContentHash.h"
+#include "core/Framebuffer.h"
+#include "core/Math.h"
+#include "core/ObjLoader.h"
+#include "core/PngWriter.h"
+#include "core/Renderer.h"
+#include "core/ThreadPool.h"
+#include "core/TileCache.h"
+#include "core/TileIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <csignal>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void usage(const char* exe) {
+  std::cerr << "Usage:\n  " << exe
+            << " input.obj|- [--port N] [--eye x y z] [--target x y z] [--fov deg]"
+               " [--ortho scale] [--features] [--tile N] [--max-zoom Z]"
+               " [--cache-mb N] [--cache-dir DIR] [--disk-mb N]\n";
+}
+
+// Deepest level served: unit coordinates are floats, so past 2^24 pixels
+// across the image lines would land on a coarser grid than the pixels
+static const int kZoomLimit = 16;
+
+namespace {
+struct Server {
+  const TileIndex* index = nullptr;
+  TileCache* cache = nullptr;
+  int tile = 256;
+  int maxZoom = 10;
+  std::atomic<uint64_t> requests{0}, renderMicros{0}, linesVisited{0};
+};
+
+using Clock = std::chrono::steady_clock;
+// How long a client may take to send its request or read the response
+static const auto kTimeout = std::chrono::seconds(5);
+
+// A connection the I/O thread reads a request from, then writes the
+// response to; `busy` while its tile renders on the pool
+struct Connection {
+  std::string in, out;
+  size_t sent = 0;
+  bool busy = false;
+  Clock::time_point deadline;
+};
+
+// Responses the pool has finished, handed back to the I/O thread; a byte
+// on the pipe wakes it
+struct Completions {
+  std::mutex mutex;
+  std::vector<std::pair<int, std::string>> ready;
+  int wake[2] = {-1, -1};
+};
+
+void setNonBlocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+std::string response(int status, const char* reason, const char* type,
+                     const char* body, size_t bytes, bool cacheable = false) {
+  std::ostringstream head;
+  head << "HTTP/1.1 " << status << " " << reason << "\r\n"
+       << "Content-Type: " << type << "\r\n"
+       << "Content-Length: " << bytes << "\r\n"
+       << (cacheable ? "Cache-Control: public, max-age=86400\r\n" : "")
+       << "Connection: close\r\n\r\n";
+  std::string r = head.str();
+  r.append(body, bytes);
+  return r;
+}
+
+std::string textResponse(int status, const char* reason, const std::string& text,
+                         const char* type = "text/plain; charset=utf-8") {
+  return response(status, reason, type, text.data(), text.size());
+}
+
+// Pan with the mouse, zoom with the wheel around the cursor
+std::string viewerPage(int tile, int maxZoom) {
+  return "<!doctype html><meta charset=utf-8><title>r3d tiles</title>"
+         "<style>body{margin:0;overflow:hidden;background:#121214}"
+         "img{position:absolute;user-select:none}</style><div id=v></div>"
+         "<script>const T=" + std::to_string(tile) +
+         ",M=" + std::to_string(maxZoom) +
+         ";let z=0,cx=.5,cy=.5,drag=null;const v=document.getElementById('v');"
+         "function draw(){const W=innerWidth,H=innerHeight,n=1<<z,s=n*T,"
+         "x0=cx*s-W/2,y0=cy*s-H/2;v.innerHTML='';"
+         "for(let y=Math.max(0,Math.floor(y0/T));y<Math.min(n,Math.ceil((y0+H)/T));y++)"
+         "for(let x=Math.max(0,Math.floor(x0/T));x<Math.min(n,Math.ceil((x0+W)/T));x++){"
+         "const i=new Image();i.draggable=false;i.src=`/${z}/${x}/${y}.png`;"
+         "i.style.left=(x*T-x0)+'px';i.style.top=(y*T-y0)+'px';v.appendChild(i);}}"
+         "onmousedown=e=>drag=[e.clientX,e.clientY];onmouseup=()=>drag=null;"
+         "onmousemove=e=>{if(!drag)return;const s=(1<<z)*T;"
+         "cx-=(e.clientX-drag[0])/s;cy-=(e.clientY-drag[1])/s;"
+         "drag=[e.clientX,e.clientY];draw();};"
+         "onwheel=e=>{const nz=Math.min(M,Math.max(0,z+(e.deltaY<0?1:-1)));"
+         "if(nz==z)return;const dx=e.clientX-innerWidth/2,dy=e.clientY-innerHeight/2;"
+         "cx+=dx/((1<<z)*T)-dx/((1<<nz)*T);cy+=dy/((1<<z)*T)-dy/((1<<nz)*T);"
+         "z=nz;draw();};onresize=draw;draw();</script>\n";
+}
+
+std::string statsText(Server& s) {
+  const TileCache::Stats c = s.cache->stats();
+  const uint64_t renders = std::max<uint64_t>(c.renders, 1);
+  std::ostringstream out;
+  out << "requests " << s.requests << "\n"
+      << "lines " << s.index->lineCount() << " (grid " << s.index->gridSize()
+      << "^2, " << (s.index->bytes() >> 10) << " KB)\n"
+      << "memory hits " << c.memoryHits << ", tiles " << c.memoryTiles << ", "
+      << (c.memoryBytes >> 10) << " KB, evictions " << c.evictions << "\n"
+      << "disk hits " << c.diskHits << ", tiles " << c.diskTiles << ", "
+      << (c.diskBytes >> 10) << " KB, evictions " << c.diskEvictions << "\n"
+      << "renders " << c.renders << ", " << (s.renderMicros / renders / 1000.0)
+      << " ms and " << (s.linesVisited / renders) << " lines per tile\n";
+  return out.str();
+}
+
+// Answers a complete (or timed out) request: pages and stats right away,
+// tiles once the pool has rendered them
+void dispatch(Server& s, Completions& done, int fd, Connection& c) {
+  ++s.requests;
+  // Only the request line matters; headers past it were read and ignored
+  std::istringstream line(c.in.substr(0, c.in.find("\r\n")));
+  std::string method, path;
+  line >> method >> path;
+  path = path.substr(0, path.find('?'));
+  if (method.empty() || path.empty()) {
+    c.out = textResponse(400, "Bad Request", "bad request\n");
+  } else if (method != "GET") {
+    c.out = textResponse(405, "Method Not Allowed", "GET only\n");
+  } else if (path == "/") {
+    c.out = textResponse(200, "OK", viewerPage(s.tile, s.maxZoom),
+                         "text/html; charset=utf-8");
+  } else if (path == "/stats") {
+    c.out = textResponse(200, "OK", statsText(s));
+  } else {
+    TileKey key;
+    int used = 0;
+    if (std::sscanf(path.c_str(), "/%d/%d/%d.png%n", &key.z, &key.x, &key.y,
+                    &used) != 3 || used != int(path.size()) ||
+        !key.valid(s.maxZoom)) {
+      c.out = textResponse(404, "Not Found", "no such tile\n");
+      return;
+    }
+    c.busy = true;
+    ThreadPool::shared().submit([&s, &done, fd, key] {
+      TileBytes png = s.cache->get(key, [&] {
+        const auto t0 = Clock::now();
+        Framebuffer img(s.tile, s.tile, 18, 18, 20);
+        std::vector<uint32_t> scratch;
+        const uint8_t color[3] = {230, 230, 240};
+        s.linesVisited += s.index->render(key, img.view(), color, scratch);
+        std::vector<uint8_t> bytes;
+        encodePNG(img.view(), bytes);
+        s.renderMicros += uint64_t(std::chrono::duration_cast<
+            std::chrono::microseconds>(Clock::now() - t0).count());
+        return bytes;
+      });
+      std::string r = response(200, "OK", "image/png",
+                               reinterpret_cast<const char*>(png->data()),
+                               png->size(), true);
+      std::lock_guard<std::mutex> lock(done.mutex);
+      done.ready.emplace_back(fd, std::move(r));
+      const char byte = 0;
+      (void)!write(done.wake[1], &byte, 1); // a full pipe is already awake
+    });
+  }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) { usage(argv[0]); return 1; }
+  std::string inPath = argv[1];
+
+  CameraOrbit cam{};
+  int port = 8080;
+  bool featuresOnly = false;
+  Server server;
+  TileCache::Options cacheOpt;
+
+  cam.target = {0,0,0};
+  cam.perspective = true;
+  cam.radius = 3.5f;
+  cam.yaw = 0.8f;
+  cam.pitch = 0.4f;
+
+  for (int i = 2; i < argc; ++i) {
+    std::string a = argv[i];
+    auto need = [&](int n){ if (i + n >= argc) { usage(argv[0]); std::exit(2);} return true; };
+    if (a == "--eye" && need(3)) {
+      float x = std::stof(argv[++i]), y = std::stof(argv[++i]), z = std::stof(argv[++i]);
+      Vec3f e{x,y,z}; Vec3f d = e - cam.target;
+      cam.radius = length(d);
+      cam.pitch = std::asin(d.y / std::max(1e-6f, cam.radius));
+      cam.yaw   = std::atan2(d.z, d.x);
+    } else if (a == "--target" && need(3)) {
+      float x = std::stof(argv[++i]), y = std::stof(argv[++i]), z = std::stof(argv[++i]);
+      cam.target = {x,y,z};
+    } else if (a == "--fov" && need(1)) {
+      cam.fovY = std::stof(argv[++i]) * 3.14159265f / 180.f;
+    } else if (a == "--ortho" && need(1)) {
+      cam.perspective = false; cam.orthoScale = std::stof(argv[++i]);
+    } else if (a == "--features") {
+      featuresOnly = true;
+    } else if (a == "--port" && need(1)) {
+      port = std::stoi(argv[++i]);
+    } else if (a == "--tile" && need(1)) {
+      server.tile = std::stoi(argv[++i]);
+    } else if (a == "--max-zoom" && need(1)) {
+      server.maxZoom = std::stoi(argv[++i]);
+    } else if (a == "--cache-mb" && need(1)) {
+      cacheOpt.memoryBytes = std::stoul(argv[++i]) << 20;
+    } else if (a == "--cache-dir" && need(1)) {
+      cacheOpt.directory = argv[++i];
+    } else if (a == "--disk-mb" && need(1)) {
+      cacheOpt.diskBytes = std::stoul(argv[++i]) << 20;
+    } else {
+      std::cerr << "Unknown arg: " << a << "\n"; usage(argv[0]); return 2;
+    }
+  }
+  if (server.tile < 16 || server.tile > 4096) {
+    std::cerr << "--tile must be between 16 and 4096\n"; return 2;
+  }
+  if (server.maxZoom < 0 || server.maxZoom > kZoomLimit) {
+    std::cerr << "--max-zoom must be between 0 and " << kZoomLimit << "\n";
+    return 2;
+  }
+
+  Mesh mesh;
+  if (!loadOBJ(inPath, mesh)) return 3;
+
+  // The whole pyramid is one square image of the view
+  RenderDesc desc;
+  desc.view = cam.view();
+  desc.proj = cam.projection(1.f);
+  desc.nearZ = cam.znear;
+  if (featuresOnly) desc.mode = RenderMode::FeatureEdges;
+  auto t0 = std::chrono::steady_clock::now();
+  FrameArena arena;
+  TileIndex index(desc, mesh, arena);
+  const double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  std::cout << "Indexed " << index.lineCount() << " lines in a "
+            << index.gridSize() << "x" << index.gridSize() << " grid ("
+            << (index.bytes() >> 20) << " MB) in " << ms << " ms\n";
+
+  if (!cacheOpt.directory.empty()) {
+    // A subdirectory per mesh content + view, so a changed mesh or camera
+    // never serves stale tiles, wherever the mesh came from; keyed on the
+    // built view, so --fov 60 and --fov 60.0 share their tiles
+    const Hash128 key = renderKey(hashMesh(mesh), desc,
+                                  "tile " + std::to_string(server.tile));
+    cacheOpt.directory += "/" + key.hex();
+  }
+  TileCache cache(cacheOpt);
+  server.index = &index;
+  server.cache = &cache;
+  if (!cacheOpt.directory.empty())
+    std::cout << "Disk cache " << cacheOpt.directory << ": "
+              << cache.stats().diskTiles << " tiles\n";
+
+  std::signal(SIGPIPE, SIG_IGN);
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  Completions done;
+  const int on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never exposed beyond the host
+  if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listener, 64) != 0 || pipe(done.wake) != 0) {
+    std::cerr << "Failed to listen on 127.0.0.1:" << port << ": "
+              << std::strerror(errno) << "\n";
+    return 4;
+  }
+  std::cout << "Serving http://127.0.0.1:" << port << "/ (" << server.tile
+            << " px tiles, zoom 0-" << server.maxZoom << ")" << std::endl;
+
+  // This thread accepts connections, reads requests and writes responses,
+  // never blocking on a client; only tile renders go to the shared pool,
+  // so a slow client never holds a worker
+  for (int fd : {listener, done.wake[0], done.wake[1]}) setNonBlocking(fd);
+  std::unordered_map<int, Connection> conns;
+  std::vector<pollfd> fds;
+  for (;;) {
+    fds.assign({{listener, POLLIN, 0}, {done.wake[0], POLLIN, 0}});
+    for (const auto& [fd, c] : conns)
+      if (!c.busy) fds.push_back({fd, short(c.out.empty() ? POLLIN : POLLOUT), 0});
+    if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+      std::cerr << "poll: " << std::strerror(errno) << "\n";
+      return 4;
+    }
+    const auto now = Clock::now();
+    while (fds[0].revents & POLLIN) {
+      const int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+        std::cerr << "accept: " << std::strerror(errno) << "\n";
+        return 4;
+      }
+      setNonBlocking(fd);
+      conns[fd].deadline = now + kTimeout;
+    }
+    if (fds[1].revents & POLLIN) {
+      char drain[256];
+      while (read(done.wake[0], drain, sizeof(drain)) > 0) {}
+      std::lock_guard<std::mutex> lock(done.mutex);
+      for (auto& [fd, r] : done.ready) {
+        Connection& c = conns[fd];
+        c.busy = false; c.out = std::move(r); c.deadline = now + kTimeout;
+      }
+      done.ready.clear();
+    }
+    for (size_t i = 2; i < fds.size(); ++i) {
+      if (!fds[i].revents) continue;
+      const int fd = fds[i].fd;
+      Connection& c = conns[fd];
+      if (c.out.empty()) {
+        char buf[2048];
+        const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) c.in.append(buf, size_t(n));
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0 || c.in.find("\r\n\r\n") != std::string::npos ||
+            c.in.size() >= 16384)
+          dispatch(server, done, fd, c);
+      } else {
+        const ssize_t n = send(fd, c.out.data() + c.sent, c.out.size() - c.sent,
+                               MSG_NOSIGNAL);
+        if (n > 0) c.sent += size_t(n);
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
+        if (n <= 0 || c.sent == c.out.size()) { close(fd); conns.erase(fd); }
+      }
+    }
+    // A request cut short is answered from what arrived; a response the
+    // client stops reading is dropped
+    for (auto it = conns.begin(); it != conns.end();) {
+      Connection& c = it->second;
+      if (c.busy || now < c.deadline) {
+        ++it;
+      } else if (c.out.empty()) {
+        dispatch(server, done, it->first, c);
+        c.deadline = now + kTimeout;
+        ++it;
+      } else {
+        close(it->first);
+        it = conns.erase(it);
+      }
+    }
+  }
+}
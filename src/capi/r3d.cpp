@@ -0,0 +1,352 @@
+#define R3D_BUILDING
+#include "r3d.h"
+
+#include "core/ContentHash.h"
+#include "core/DiskCache.h"
+#include "core/FrameArena.h"
+#include "core/MemoryReport.h"
+#include "core/ObjLoader.h"
+#include "core/Renderer.h"
+#include "core/SharedMesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+// Borrowed arrays are reinterpreted in place, which needs matching layouts
+static_assert(sizeof(Vec3f) == 3 * sizeof(float) &&
+                  std::is_standard_layout<Vec3f>::value,
+              "Vec3f must be three packed floats");
+static_assert(sizeof(std::pair<int, int>) == 2 * sizeof(int32_t) &&
+                  sizeof(int) == sizeof(int32_t),
+              "edges must be two packed int32 indices");
+
+struct r3d_mesh {
+  MeshHandle owned; // null for borrowed arrays
+  MeshView view;
+  std::once_flag boundsOnce;
+  Bounds bounds;
+  std::once_flag hashOnce;
+  Hash128 hash;
+};
+
+struct r3d_cache {
+  std::unique_ptr<DiskCache> disk;
+};
+
+struct r3d_context {
+  FrameArena arena;
+  r3d_stats stats{};
+};
+
+namespace {
+template <typename F> r3d_status guarded(F &&fn) {
+  try {
+    return fn();
+  } catch (const std::bad_alloc &) {
+    return R3D_ERROR_OUT_OF_MEMORY;
+  } catch (...) {
+    return R3D_ERROR_INTERNAL;
+  }
+}
+
+Mat4 toMat4(const float *a) {
+  Mat4 m;
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 4; ++j)
+      m.m[i][j] = a[i * 4 + j];
+  return m;
+}
+
+bool toDesc(const r3d_view *v, RenderDesc &d) {
+  if (!v || v->width <= 0 || v->height <= 0 || !(v->near_z > 0.f))
+    return false;
+  d.width = v->width;
+  d.height = v->height;
+  d.model = toMat4(v->model);
+  d.view = toMat4(v->view);
+  d.proj = toMat4(v->proj);
+  d.nearZ = v->near_z;
+  return true;
+}
+
+// Keys are what r3d_render_key() writes: 32 lowercase hex digits
+bool validKey(const char *key) {
+  if (!key)
+    return false;
+  for (int i = 0; i < R3D_KEY_SIZE - 1; ++i)
+    if (!((key[i] >= '0' && key[i] <= '9') || (key[i] >= 'a' && key[i] <= 'f')))
+      return false;
+  return key[R3D_KEY_SIZE - 1] == '\0';
+}
+
+// Entries are spread over 256 subdirectories by their first two digits
+std::string entryName(const char *key) {
+  return std::string(key, 2) + "/" + std::string(key);
+}
+
+// Runs one render on the context and records its stats; `fn` is
+// renderLines or renderLineStreams
+template <typename Fn = decltype(&renderLines)>
+auto render(r3d_context *ctx, const r3d_mesh *mesh, const RenderDesc &d,
+            Fn fn = &renderLines) {
+  auto t0 = std::chrono::steady_clock::now();
+  ctx->arena.reset();
+  auto lines = fn(d, mesh->view, ctx->arena);
+  ctx->stats.edges_in = mesh->view.edgeCount;
+  ctx->stats.lines_out = lines.size;
+  ctx->stats.render_ns = uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - t0)
+          .count());
+  ctx->stats.scratch_bytes = ctx->arena.bytesReserved();
+  return lines;
+}
+} // namespace
+
+uint32_t r3d_version(void) { return R3D_VERSION; }
+
+const char *r3d_status_string(r3d_status status) {
+  switch (status) {
+  case R3D_OK:
+    return "ok";
+  case R3D_ERROR_INVALID_ARGUMENT:
+    return "invalid argument";
+  case R3D_ERROR_IO:
+    return "could not read input";
+  case R3D_ERROR_OUT_OF_MEMORY:
+    return "out of memory";
+  case R3D_ERROR_BUFFER_TOO_SMALL:
+    return "output buffer too small";
+  case R3D_ERROR_INTERNAL:
+    return "internal error";
+  case R3D_ERROR_NOT_FOUND:
+    return "not found";
+  }
+  return "unknown status";
+}
+
+r3d_status r3d_mesh_create(const float *xyz, size_t vertex_count,
+                           const int32_t *edges, size_t edge_count,
+                           r3d_mesh **out) {
+  if (!out || (vertex_count && !xyz) || (edge_count && !edges))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  *out = nullptr;
+  for (size_t i = 0; i < 2 * edge_count; ++i)
+    if (edges[i] < 0 || size_t(edges[i]) >= vertex_count)
+      return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    auto *m = new r3d_mesh;
+    m->view.vertices = reinterpret_cast<const Vec3f *>(xyz);
+    m->view.vertexCount = vertex_count;
+    m->view.edges = reinterpret_cast<const std::pair<int, int> *>(edges);
+    m->view.edgeCount = edge_count;
+    *out = m;
+    return R3D_OK;
+  });
+}
+
+r3d_status r3d_mesh_load_obj(const char *path, r3d_mesh **out) {
+  if (!path || !out)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  *out = nullptr;
+  return guarded([&] {
+    Mesh mesh;
+    if (!loadOBJ(path, mesh))
+      return R3D_ERROR_IO;
+    auto *m = new r3d_mesh;
+    m->owned = SharedMesh::freeze(std::move(mesh));
+    m->view = *m->owned;
+    *out = m;
+    return R3D_OK;
+  });
+}
+
+void r3d_mesh_free(r3d_mesh *mesh) { delete mesh; }
+
+r3d_status r3d_mesh_get_info(const r3d_mesh *mesh, r3d_mesh_info *info) {
+  if (!mesh || !info)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    auto *m = const_cast<r3d_mesh *>(mesh);
+    std::call_once(m->boundsOnce, [m] {
+      if (m->owned) {
+        m->bounds = m->owned->bounds();
+        return;
+      }
+      for (size_t i = 0; i < m->view.vertexCount; ++i)
+        m->bounds.expand(m->view.vertices[i]);
+    });
+    info->vertex_count = mesh->view.vertexCount;
+    info->edge_count = mesh->view.edgeCount;
+    const Bounds &b = mesh->bounds;
+    const float mn[3] = {b.min.x, b.min.y, b.min.z};
+    const float mx[3] = {b.max.x, b.max.y, b.max.z};
+    for (int i = 0; i < 3; ++i) {
+      info->bounds_min[i] = mn[i];
+      info->bounds_max[i] = mx[i];
+    }
+    return R3D_OK;
+  });
+}
+
+r3d_context *r3d_context_create(void) {
+  try {
+    return new r3d_context;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void r3d_context_free(r3d_context *ctx) { delete ctx; }
+
+r3d_status r3d_context_get_stats(const r3d_context *ctx, r3d_stats *stats) {
+  if (!ctx || !stats)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  *stats = ctx->stats;
+  return R3D_OK;
+}
+
+r3d_status r3d_get_memory_info(const r3d_mesh *mesh, const r3d_context *ctx,
+                               r3d_memory_info *info) {
+  if (!info)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    MemoryReport report;
+    if (mesh && mesh->owned)
+      addMesh(report, *mesh->owned);
+    if (ctx)
+      addArena(report, ctx->arena);
+    *info = r3d_memory_info{};
+    for (const MemoryItem &item : report.items()) {
+      auto add = [&](uint64_t &used, uint64_t &reserved) {
+        used += item.used;
+        reserved += item.reserved;
+      };
+      if (item.subsystem == "mesh")
+        add(info->mesh_used, info->mesh_reserved);
+      else if (item.subsystem == "derived")
+        add(info->derived_used, info->derived_reserved);
+      else
+        add(info->scratch_used, info->scratch_reserved);
+    }
+    info->resident_bytes = residentBytes();
+    info->peak_resident_bytes = peakResidentBytes();
+    return R3D_OK;
+  });
+}
+
+r3d_status r3d_render_lines(r3d_context *ctx, const r3d_mesh *mesh,
+                            const r3d_view *view, r3d_line *lines,
+                            size_t capacity, size_t *count) {
+  RenderDesc d;
+  if (!ctx || !mesh || !count || (capacity && !lines) || !toDesc(view, d))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    ArenaSpan<ScreenLine> out = render(ctx, mesh, d);
+    const size_t n = std::min(out.size, capacity);
+    for (size_t i = 0; i < n; ++i)
+      lines[i] = {out[i].a.x, out[i].a.y, out[i].b.x, out[i].b.y};
+    *count = out.size;
+    return out.size > capacity ? R3D_ERROR_BUFFER_TOO_SMALL : R3D_OK;
+  });
+}
+
+r3d_status r3d_render_line_streams(r3d_context *ctx, const r3d_mesh *mesh,
+                                   const r3d_view *view, float *x0, float *y0,
+                                   float *x1, float *y1, size_t capacity,
+                                   size_t *count) {
+  RenderDesc d;
+  if (!ctx || !mesh || !count || (capacity && (!x0 || !y0 || !x1 || !y1)) ||
+      !toDesc(view, d))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    ScreenLines out = render(ctx, mesh, d, &renderLineStreams);
+    const size_t n = std::min(out.size, capacity);
+    std::copy(out.ax, out.ax + n, x0);
+    std::copy(out.ay, out.ay + n, y0);
+    std::copy(out.bx, out.bx + n, x1);
+    std::copy(out.by, out.by + n, y1);
+    *count = out.size;
+    return out.size > capacity ? R3D_ERROR_BUFFER_TOO_SMALL : R3D_OK;
+  });
+}
+
+r3d_status r3d_render_rgb(r3d_context *ctx, const r3d_mesh *mesh,
+                          const r3d_view *view, uint8_t *pixels,
+                          size_t stride, const uint8_t rgb[3]) {
+  RenderDesc d;
+  if (!ctx || !mesh || !pixels || !rgb || !toDesc(view, d) ||
+      stride < size_t(view->width) * 3)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  d.target = {pixels, d.width, d.height, stride};
+  for (int i = 0; i < 3; ++i)
+    d.color[i] = rgb[i];
+  return guarded([&] {
+    render(ctx, mesh, d);
+    return R3D_OK;
+  });
+}
+
+r3d_status r3d_render_key(const r3d_mesh *mesh, const r3d_view *view,
+                          const void *extra, size_t extra_size,
+                          char key[R3D_KEY_SIZE]) {
+  RenderDesc d;
+  if (!mesh || !key || (extra_size && !extra) || !toDesc(view, d))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    auto *m = const_cast<r3d_mesh *>(mesh);
+    std::call_once(m->hashOnce, [m] { m->hash = hashMesh(m->view); });
+    const std::string variant(static_cast<const char *>(extra), extra_size);
+    const std::string hex = renderKey(mesh->hash, d, variant).hex();
+    std::memcpy(key, hex.c_str(), R3D_KEY_SIZE);
+    return R3D_OK;
+  });
+}
+
+r3d_status r3d_cache_open(const char *directory, uint64_t max_bytes,
+                          r3d_cache **out) {
+  if (!directory || !*directory || !out)
+    return R3D_ERROR_INVALID_ARGUMENT;
+  *out = nullptr;
+  return guarded([&] {
+    auto *c = new r3d_cache;
+    c->disk.reset(new DiskCache(directory, size_t(max_bytes)));
+    *out = c;
+    return R3D_OK;
+  });
+}
+
+void r3d_cache_free(r3d_cache *cache) { delete cache; }
+
+r3d_status r3d_cache_get(r3d_cache *cache, const char *key, void *data,
+                         size_t capacity, size_t *size) {
+  if (!cache || !validKey(key) || !size || (capacity && !data))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    std::vector<uint8_t> bytes;
+    if (!cache->disk->read(entryName(key), bytes))
+      return R3D_ERROR_NOT_FOUND;
+    *size = bytes.size();
+    if (bytes.size() > capacity)
+      return R3D_ERROR_BUFFER_TOO_SMALL;
+    std::memcpy(data, bytes.data(), bytes.size());
+    return R3D_OK;
+  });
+}
+
+r3d_status r3d_cache_put(r3d_cache *cache, const char *key, const void *data,
+                         size_t size) {
+  if (!cache || !validKey(key) || (size && !data))
+    return R3D_ERROR_INVALID_ARGUMENT;
+  return guarded([&] {
+    return cache->disk->write(entryName(key),
+                              static_cast<const uint8_t *>(data), size)
+               ? R3D_OK
+               : R3D_ERROR_IO;
+  });
+}
@@ -0,0 +1,169 @@
+/* C interface to the wireframe renderer, built as the shared library r3d.
+ *
+ * Meshes are immutable once created and may be shared between threads.
+ * Rendering needs a context for scratch memory; use one context per thread.
+ * No C++ types or exceptions cross this interface.
+ *
+ * Matrices are 16 floats, row-major, for column vectors (p' = M p), the same
+ * convention as the OpenGL-style lookAt/perspective helpers.
+ */
+#ifndef R3D_H
+#define R3D_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(R3D_BUILDING)
+#define R3D_API __declspec(dllexport)
+#else
+#define R3D_API __declspec(dllimport)
+#endif
+#else
+#define R3D_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on incompatible changes (major), additions (minor) and fixes. */
+#define R3D_VERSION_MAJOR 1
+#define R3D_VERSION_MINOR 3
+#define R3D_VERSION_PATCH 0
+#define R3D_VERSION                                                            \
+  ((R3D_VERSION_MAJOR << 16) | (R3D_VERSION_MINOR << 8) | R3D_VERSION_PATCH)
+
+typedef enum r3d_status {
+  R3D_OK = 0,
+  R3D_ERROR_INVALID_ARGUMENT = 1,
+  R3D_ERROR_IO = 2,
+  R3D_ERROR_OUT_OF_MEMORY = 3,
+  R3D_ERROR_BUFFER_TOO_SMALL = 4, /* output truncated; see the count */
+  R3D_ERROR_INTERNAL = 5,
+  R3D_ERROR_NOT_FOUND = 6 /* cache miss (Since 1.2) */
+} r3d_status;
+
+typedef struct r3d_mesh r3d_mesh;
+typedef struct r3d_context r3d_context;
+typedef struct r3d_cache r3d_cache;
+
+/* Size of a render key: 32 hex digits and a NUL. */
+#define R3D_KEY_SIZE 33
+
+typedef struct r3d_view {
+  int32_t width, height; /* viewport in pixels */
+  float model[16];
+  float view[16];
+  float proj[16];
+  float near_z; /* near clipping distance in camera space (> 0) */
+} r3d_view;
+
+typedef struct r3d_line {
+  float x0, y0, x1, y1; /* pixel coordinates, y down */
+} r3d_line;
+
+typedef struct r3d_mesh_info {
+  size_t vertex_count;
+  size_t edge_count;
+  float bounds_min[3], bounds_max[3]; /* min > max for an empty mesh */
+} r3d_mesh_info;
+
+/* Counters of the last render call on a context. */
+typedef struct r3d_stats {
+  uint64_t edges_in;      /* edges submitted */
+  uint64_t lines_out;     /* lines surviving clipping and projection */
+  uint64_t render_ns;     /* wall time of the call */
+  uint64_t scratch_bytes; /* scratch memory held by the context */
+} r3d_stats;
+
+/* Memory held by a mesh and a context, in bytes. `*_reserved` counts what
+ * is allocated, so reserved - used is slack. (Since 1.1) */
+typedef struct r3d_memory_info {
+  uint64_t mesh_used, mesh_reserved; /* vertices, edges, objects; 0 when
+                                        the arrays are borrowed */
+  uint64_t derived_used, derived_reserved; /* edge classification */
+  uint64_t scratch_used, scratch_reserved; /* context scratch as of the
+                                              last render */
+  uint64_t resident_bytes, peak_resident_bytes; /* whole process; 0 where
+                                                   unknown */
+} r3d_memory_info;
+
+/* Runtime version, R3D_VERSION of the library actually loaded. */
+R3D_API uint32_t r3d_version(void);
+R3D_API const char *r3d_status_string(r3d_status status);
+
+/* Wraps caller-owned arrays without copying: `xyz` holds 3 floats per vertex
+ * and `edges` 2 vertex indices per edge. Both must stay valid and unchanged
+ * until r3d_mesh_free(). Edge indices are validated here. */
+R3D_API r3d_status r3d_mesh_create(const float *xyz, size_t vertex_count,
+                                   const int32_t *edges, size_t edge_count,
+                                   r3d_mesh **out);
+/* Loads a Wavefront OBJ file; the mesh owns its data. */
+R3D_API r3d_status r3d_mesh_load_obj(const char *path, r3d_mesh **out);
+R3D_API void r3d_mesh_free(r3d_mesh *mesh);
+R3D_API r3d_status r3d_mesh_get_info(const r3d_mesh *mesh,
+                                     r3d_mesh_info *info);
+
+R3D_API r3d_context *r3d_context_create(void);
+R3D_API void r3d_context_free(r3d_context *ctx);
+R3D_API r3d_status r3d_context_get_stats(const r3d_context *ctx,
+                                         r3d_stats *stats);
+/* Either `mesh` or `ctx` may be NULL; its fields are then 0. (Since 1.1) */
+R3D_API r3d_status r3d_get_memory_info(const r3d_mesh *mesh,
+                                       const r3d_context *ctx,
+                                       r3d_memory_info *info);
+
+/* Projects the mesh edges into `lines` (capacity entries). `*count` receives
+ * the number of visible lines; if it exceeds the capacity, only the first
+ * `capacity` are written and R3D_ERROR_BUFFER_TOO_SMALL is returned. */
+R3D_API r3d_status r3d_render_lines(r3d_context *ctx, const r3d_mesh *mesh,
+                                    const r3d_view *view, r3d_line *lines,
+                                    size_t capacity, size_t *count);
+
+/* Same lines as four coordinate arrays of `capacity` floats each (structure
+ * of arrays): line i runs from (x0[i], y0[i]) to (x1[i], y1[i]). Truncation
+ * works as in r3d_render_lines. (Since 1.3) */
+R3D_API r3d_status r3d_render_line_streams(r3d_context *ctx,
+                                           const r3d_mesh *mesh,
+                                           const r3d_view *view, float *x0,
+                                           float *y0, float *x1, float *y1,
+                                           size_t capacity, size_t *count);
+
+/* Draws the mesh edges in `rgb` into caller pixels: 3 bytes per pixel,
+ * `stride` bytes per row, view->width x view->height pixels. Pixels not on a
+ * line are left untouched. */
+R3D_API r3d_status r3d_render_rgb(r3d_context *ctx, const r3d_mesh *mesh,
+                                  const r3d_view *view, uint8_t *pixels,
+                                  size_t stride, const uint8_t rgb[3]);
+
+/* Content-addressed key of a render: a hash of the mesh data, the view
+ * (matrices quantized to ~1e-6 relative, so recomputed cameras still match)
+ * and `extra` bytes for whatever else the caller varies, e.g. colours or
+ * the output format. A mesh is hashed once, on first use; borrowed arrays
+ * must therefore not change. (Since 1.2) */
+R3D_API r3d_status r3d_render_key(const r3d_mesh *mesh, const r3d_view *view,
+                                  const void *extra, size_t extra_size,
+                                  char key[R3D_KEY_SIZE]);
+
+/* Directory of render results stored by key. Entries go to the subdirectory
+ * "r3d-cache" of `directory`, which is created on the first put; nothing
+ * else in `directory` is touched. Past `max_bytes` the least recently used
+ * entries are deleted. Entries are written atomically, so several processes
+ * may share a directory. Safe to use from several threads. (Since 1.2) */
+R3D_API r3d_status r3d_cache_open(const char *directory, uint64_t max_bytes,
+                                  r3d_cache **out);
+R3D_API void r3d_cache_free(r3d_cache *cache);
+/* Copies the entry for `key` into `data` (capacity bytes) and sets `*size`.
+ * Returns R3D_ERROR_NOT_FOUND on a miss, or R3D_ERROR_BUFFER_TOO_SMALL with
+ * only `*size` set if the entry does not fit. */
+R3D_API r3d_status r3d_cache_get(r3d_cache *cache, const char *key,
+                                 void *data, size_t capacity, size_t *size);
+R3D_API r3d_status r3d_cache_put(r3d_cache *cache, const char *key,
+                                 const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* R3D_H */
@@ -0,0 +1,56 @@
+#include "AsyncLoad.h"
+#include "ThreadPool.h"
+#include <chrono>
+
+bool MeshLoadHandle::ready() const {
+  return m_state && m_state->future.wait_for(std::chrono::seconds(0)) ==
+                        std::future_status::ready;
+}
+
+LoadProgress MeshLoadHandle::progress() const {
+  if (!m_state)
+    return {};
+  std::lock_guard<std::mutex> lk(m_state->mutex);
+  return m_state->progress;
+}
+
+void MeshLoadHandle::cancel() {
+  if (m_state)
+    m_state->cancel.store(true, std::memory_order_relaxed);
+}
+
+MeshLoadHandle
+loadOBJAsync(const std::string &path,
+             std::function<void(const LoadProgress &)> onProgress) {
+  auto st = std::make_shared<MeshLoadHandle::State>();
+  st->path = path;
+  st->future = st->promise.get_future().share();
+  st->onProgress = std::move(onProgress);
+
+  // The task owns the state, so it outlives a handle dropped mid-load
+  ThreadPool::shared().submit([st] {
+    LoadOptions opt;
+    opt.cancel = &st->cancel;
+    opt.onProgress = [&st](const LoadProgress &p) {
+      {
+        std::lock_guard<std::mutex> lk(st->mutex);
+        st->progress = p;
+      }
+      if (st->onProgress)
+        st->onProgress(p);
+    };
+    try {
+      Mesh mesh;
+      if (loadOBJ(st->path, mesh, opt))
+        st->promise.set_value(SharedMesh::freeze(std::move(mesh)));
+      else
+        st->promise.set_value(nullptr);
+    } catch (...) {
+      st->promise.set_exception(std::current_exception());
+    }
+  });
+
+  MeshLoadHandle h;
+  h.m_state = std::move(st);
+  return h;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Mesh.h"
+#include "ObjLoader.h"
+#include "SharedMesh.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Handle to an OBJ load running on the shared thread pool. The future yields
+// the frozen mesh, or nullptr if the load failed or was cancelled. Destroying or
+// reassigning the handle cancels a load that is still running; the loader
+// notices between chunks, so abandoned loads release their threads quickly.
+class MeshLoadHandle {
+public:
+  using MeshPtr = MeshHandle;
+
+  MeshLoadHandle() = default;
+  MeshLoadHandle(MeshLoadHandle &&) = default;
+  MeshLoadHandle &operator=(MeshLoadHandle &&o) {
+    cancel();
+    m_state = std::move(o.m_state);
+    return *this;
+  }
+  ~MeshLoadHandle() { cancel(); }
+
+  bool valid() const { return m_state != nullptr; }
+  bool ready() const;
+  const std::shared_future<MeshPtr> &future() const { return m_state->future; }
+  // Latest progress; safe to poll from any thread (e.g. a UI timer).
+  LoadProgress progress() const;
+  const std::string &path() const { return m_state->path; }
+  void cancel();
+
+private:
+  struct State {
+    std::string path;
+    std::atomic<bool> cancel{false};
+    std::promise<MeshPtr> promise;
+    std::shared_future<MeshPtr> future;
+    mutable std::mutex mutex;
+    LoadProgress progress;
+    std::function<void(const LoadProgress &)> onProgress;
+  };
+  friend MeshLoadHandle
+  loadOBJAsync(const std::string &path,
+               std::function<void(const LoadProgress &)> onProgress);
+
+  std::shared_ptr<State> m_state;
+};
+
+// Starts loading `path` in the background. `onProgress` runs on a pool
+// thread after every merged chunk.
+MeshLoadHandle
+loadOBJAsync(const std::string &path,
+             std::function<void(const LoadProgress &)> onProgress = {});
@@ -0,0 +1,215 @@
+#include "Components.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+// Union-find whose roots only ever change by CAS from themselves to a
+// smaller index, so any interleaving of unions ends with every component
+// rooted at its lowest vertex.
+class ConcurrentUnionFind {
+public:
+  explicit ConcurrentUnionFind(size_t n)
+      : m_parent(new std::atomic<uint32_t>[n]) {
+    parallelFor(0, n, 65536, [&](size_t lo, size_t hi) {
+      for (size_t i = lo; i < hi; ++i)
+        m_parent[i].store(uint32_t(i), std::memory_order_relaxed);
+    });
+  }
+
+  uint32_t find(uint32_t x) {
+    for (;;) {
+      uint32_t p = m_parent[x].load(std::memory_order_relaxed);
+      if (p == x)
+        return x;
+      // Path halving; losing the race only means less compression
+      uint32_t gp = m_parent[p].load(std::memory_order_relaxed);
+      if (gp != p)
+        m_parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+      x = gp;
+    }
+  }
+
+  void unite(uint32_t a, uint32_t b) {
+    for (;;) {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return;
+      if (a < b)
+        std::swap(a, b);
+      uint32_t expected = a;
+      if (m_parent[a].compare_exchange_strong(expected, b,
+                                              std::memory_order_relaxed))
+        return;
+    }
+  }
+
+private:
+  std::unique_ptr<std::atomic<uint32_t>[]> m_parent;
+};
+
+const char *kindName(EdgeKind k) {
+  switch (k) {
+  case EdgeKind::Smooth:
+    return "smooth";
+  case EdgeKind::Crease:
+    return "crease";
+  case EdgeKind::Boundary:
+    return "boundary";
+  case EdgeKind::NonManifold:
+    return "non-manifold";
+  }
+  return "?";
+}
+} // namespace
+
+size_t splitComponents(Mesh &mesh) {
+  const size_t nv = mesh.vertices.size();
+  const size_t ne = mesh.edges.size();
+  if (!mesh.objects.empty() || ne == 0)
+    return 0;
+  for (const auto &e : mesh.edges)
+    if (e.first < 0 || e.second < 0 || size_t(e.first) >= nv ||
+        size_t(e.second) >= nv)
+      return 0;
+
+  ConcurrentUnionFind uf(nv);
+  parallelFor(0, ne, 16384, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i)
+      uf.unite(uint32_t(mesh.edges[i].first), uint32_t(mesh.edges[i].second));
+  });
+
+  // Components are the roots with edges, numbered in root (lowest vertex)
+  // order; vertices without edges get the label after the last one
+  std::vector<uint32_t> root(nv);
+  parallelFor(0, nv, 65536, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i)
+      root[i] = uf.find(uint32_t(i));
+  });
+  std::vector<uint8_t> hasEdges(nv, 0);
+  for (const auto &e : mesh.edges)
+    hasEdges[root[size_t(e.first)]] = 1;
+  std::vector<uint32_t> rootLabel(nv, 0);
+  uint32_t count = 0;
+  for (size_t i = 0; i < nv; ++i)
+    if (root[i] == i && hasEdges[i])
+      rootLabel[i] = count++;
+  std::vector<uint32_t> label(nv);
+  parallelFor(0, nv, 65536, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i)
+      label[i] = hasEdges[root[i]] ? rootLabel[root[i]] : count;
+  });
+  std::vector<uint32_t>().swap(root);
+  std::vector<uint32_t>().swap(rootLabel);
+
+  // Stable counting sort of vertices by label
+  std::vector<size_t> vStart(count + 2, 0);
+  for (size_t i = 0; i < nv; ++i)
+    ++vStart[label[i] + 1];
+  for (size_t c = 0; c <= count; ++c)
+    vStart[c + 1] += vStart[c];
+  std::vector<uint32_t> newIndex(nv);
+  {
+    std::vector<size_t> at(vStart.begin(), vStart.end() - 1);
+    for (size_t i = 0; i < nv; ++i)
+      newIndex[i] = uint32_t(at[label[i]]++);
+  }
+  LargeVector<Vec3f> vertices(nv);
+  parallelFor(0, nv, 65536, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i)
+      vertices[newIndex[i]] = mesh.vertices[i];
+  });
+
+  // Stable counting sort of edges by the label of their first vertex
+  std::vector<size_t> eStart(count + 1, 0);
+  for (const auto &e : mesh.edges)
+    ++eStart[label[size_t(e.first)] + 1];
+  for (size_t c = 0; c < count; ++c)
+    eStart[c + 1] += eStart[c];
+  std::vector<uint32_t> edgeAt(ne);
+  {
+    std::vector<size_t> at(eStart.begin(), eStart.end() - 1);
+    for (size_t i = 0; i < ne; ++i)
+      edgeAt[i] = uint32_t(at[label[size_t(mesh.edges[i].first)]]++);
+  }
+  LargeVector<std::pair<int, int>> edges(ne);
+  const bool classified = mesh.classified();
+  LargeVector<EdgeKind> kinds(classified ? ne : 0);
+  parallelFor(0, ne, 65536, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i) {
+      const auto &e = mesh.edges[i];
+      edges[edgeAt[i]] = {int(newIndex[size_t(e.first)]),
+                          int(newIndex[size_t(e.second)])};
+      if (classified)
+        kinds[edgeAt[i]] = mesh.edgeKinds[i];
+    }
+  });
+
+  mesh.vertices = std::move(vertices);
+  mesh.edges = std::move(edges);
+  if (classified) {
+    mesh.edgeKinds = std::move(kinds);
+    mesh.featureEdges.clear();
+    for (size_t i = 0; i < ne; ++i)
+      if (mesh.edgeKinds[i] != EdgeKind::Smooth)
+        mesh.featureEdges.push_back(uint32_t(i));
+  }
+
+  mesh.objects.resize(count);
+  parallelFor(0, count, 64, [&](size_t lo, size_t hi) {
+    for (size_t c = lo; c < hi; ++c) {
+      MeshObject &obj = mesh.objects[c];
+      obj.firstEdge = int(eStart[c]);
+      obj.edgeCount = int(eStart[c + 1] - eStart[c]);
+      obj.firstVertex = int(vStart[c]);
+      obj.endVertex = int(vStart[c + 1]);
+      for (size_t i = vStart[c]; i < vStart[c + 1]; ++i)
+        obj.bounds.expand(mesh.vertices[i]);
+    }
+  });
+  return count;
+}
+
+void printMeshSummary(std::ostream &os, const Mesh &mesh, size_t maxObjects) {
+  os << "Vertices: " << mesh.vertices.size() << "\n"
+     << "Edges:    " << mesh.edges.size() << "\n";
+  if (mesh.classified()) {
+    size_t kinds[4] = {0, 0, 0, 0};
+    for (EdgeKind k : mesh.edgeKinds)
+      ++kinds[size_t(k)];
+    os << "  feature edges: " << mesh.featureEdges.size() << " (";
+    for (size_t k = 1; k < 4; ++k)
+      os << (k > 1 ? ", " : "") << kinds[k] << " "
+         << kindName(EdgeKind(k));
+    os << ")\n";
+  }
+  os << "Objects:  " << mesh.objects.size() << "\n";
+  if (mesh.objects.empty())
+    return;
+
+  std::vector<size_t> order(mesh.objects.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  const size_t shown = std::min(maxObjects, order.size());
+  std::partial_sort(order.begin(), order.begin() + std::ptrdiff_t(shown),
+                    order.end(), [&](size_t a, size_t b) {
+                      return mesh.objects[a].edgeCount >
+                             mesh.objects[b].edgeCount;
+                    });
+  for (size_t r = 0; r < shown; ++r) {
+    const MeshObject &o = mesh.objects[order[r]];
+    const Vec3f size = o.bounds.empty() ? Vec3f{} : o.bounds.max - o.bounds.min;
+    os << "  #" << order[r] << " "
+       << (o.name.empty() ? std::string("(unnamed)") : o.name) << ": "
+       << o.edgeCount << " edges, " << (o.endVertex - o.firstVertex)
+       << " vertices, size " << size.x << " x " << size.y << " x " << size.z
+       << "\n";
+  }
+  if (shown < order.size())
+    os << "  ... " << (order.size() - shown) << " more\n";
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include "Mesh.h"
+#include <cstddef>
+#include <ostream>
+
+// Splits a mesh without `o` groups into its connected components. Vertices
+// and edges are reordered so every component is contiguous, and each one
+// becomes a MeshObject (with an empty name) carrying its edge and vertex
+// ranges and bounds, so it can be culled, drawn or hidden as a unit.
+// Components are ordered by their lowest original vertex, and the order
+// within a component is kept. Vertices without edges move to the end,
+// outside every object.
+//
+// Labeling is a lock-free parallel union-find over the edges. Returns the
+// number of components; meshes that already have objects, or have edges
+// with out-of-range indices, are left alone and return 0.
+size_t splitComponents(Mesh &mesh);
+
+// Human-readable overview: counts, edge kinds and the largest objects or
+// components with their extents.
+void printMeshSummary(std::ostream &os, const Mesh &mesh,
+                      size_t maxObjects = 10);
@@ -0,0 +1,166 @@
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+const uint64_t kPrime1 = 11400714785074694791ull;
+const uint64_t kPrime2 = 14029467366897019727ull;
+const uint64_t kPrime3 = 1609587929392839161ull;
+const uint64_t kPrime4 = 9650029242287828579ull;
+const uint64_t kPrime5 = 2870177450012600261ull;
+
+// Bumped whenever the renderer's output changes, so old entries stop
+// matching
+const uint64_t kRenderKeyVersion = 1;
+
+uint64_t rotl(uint64_t v, int r) { return v << r | v >> (64 - r); }
+
+uint64_t mixLane(uint64_t acc, uint64_t input) {
+  return rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+uint64_t avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  return h ^ h >> 32;
+}
+
+uint64_t load64(const uint8_t *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+} // namespace
+
+std::string Hash128::hex() const {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string s(32, '0');
+  for (int i = 0; i < 16; ++i) {
+    s[size_t(15 - i)] = kDigits[(hi >> (4 * i)) & 15];
+    s[size_t(31 - i)] = kDigits[(lo >> (4 * i)) & 15];
+  }
+  return s;
+}
+
+Hasher::Hasher(uint64_t seed)
+    : m_lanes{seed + kPrime1 + kPrime2, seed + kPrime2, seed,
+              seed - kPrime1} {}
+
+void Hasher::consume(const uint8_t *block) {
+  for (int i = 0; i < 4; ++i)
+    m_lanes[i] = mixLane(m_lanes[i], load64(block + 8 * i));
+}
+
+void Hasher::add(const void *data, size_t size) {
+  if (size == 0)
+    return;
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  m_total += size;
+  if (m_buffered > 0) {
+    const size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+    std::memcpy(m_buffer + m_buffered, p, take);
+    m_buffered += take;
+    p += take;
+    size -= take;
+    if (m_buffered < sizeof(m_buffer))
+      return;
+    consume(m_buffer);
+    m_buffered = 0;
+  }
+  for (; size >= 32; p += 32, size -= 32)
+    consume(p);
+  std::memcpy(m_buffer, p, size);
+  m_buffered = size;
+}
+
+void Hasher::addString(const std::string &s) {
+  addValue(uint64_t(s.size()));
+  add(s.data(), s.size());
+}
+
+void Hasher::addQuantized(float v) {
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  bits = (bits + 8u) & ~15u;
+  if ((bits & 0x7fffffffu) == 0)
+    bits = 0; // -0 == +0
+  addValue(bits);
+}
+
+Hash128 Hasher::finish() const {
+  // Lanes merged two ways, then the tail bytes folded into both halves
+  const uint64_t *v = m_lanes;
+  uint64_t a = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) +
+               rotl(v[3], 18) + m_total;
+  uint64_t b = rotl(v[0], 41) ^ rotl(v[1], 29) ^ rotl(v[2], 17) ^
+               rotl(v[3], 5) ^ (m_total * kPrime5);
+  for (size_t i = 0; i < m_buffered; ++i) {
+    a = rotl(a ^ m_buffer[i] * kPrime5, 11) * kPrime1;
+    b = rotl(b + m_buffer[i] * kPrime4, 23) * kPrime2;
+  }
+  Hash128 h;
+  h.lo = avalanche(a ^ mixLane(0, b));
+  h.hi = avalanche(b + mixLane(kPrime4, a));
+  return h;
+}
+
+bool hashFile(const std::string &path, Hash128 &out) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f)
+    return false;
+  Hasher h;
+  std::vector<char> block(size_t(4) << 20);
+  while (f) {
+    f.read(block.data(), std::streamsize(block.size()));
+    h.add(block.data(), size_t(f.gcount()));
+  }
+  if (f.bad())
+    return false;
+  out = h.finish();
+  return true;
+}
+
+Hash128 hashMesh(const MeshView &mesh) {
+  Hasher h;
+  h.addValue(uint64_t(mesh.vertexCount));
+  h.add(mesh.vertices, mesh.vertexCount * sizeof(Vec3f));
+  h.addValue(uint64_t(mesh.edgeCount));
+  h.add(mesh.edges, mesh.edgeCount * sizeof(std::pair<int, int>));
+  h.addValue(uint8_t(mesh.classified));
+  if (mesh.classified) {
+    h.addValue(uint64_t(mesh.featureCount));
+    h.add(mesh.featureEdges, mesh.featureCount * sizeof(uint32_t));
+    if (mesh.edgeKinds)
+      h.add(mesh.edgeKinds, mesh.edgeCount * sizeof(EdgeKind));
+  }
+  h.addValue(uint64_t(mesh.objectCount));
+  for (size_t i = 0; i < mesh.objectCount; ++i) {
+    const MeshObject &o = mesh.objects[i];
+    const int32_t range[4] = {o.firstEdge, o.edgeCount, o.firstVertex,
+                              o.endVertex};
+    h.addValue(range);
+  }
+  return h.finish();
+}
+
+Hash128 renderKey(const Hash128 &mesh, const RenderDesc &desc,
+                  const std::string &variant) {
+  Hasher h(kRenderKeyVersion);
+  h.addValue(mesh.lo);
+  h.addValue(mesh.hi);
+  const int32_t size[2] = {desc.width, desc.height};
+  h.addValue(size);
+  for (const Mat4 *m : {&desc.model, &desc.view, &desc.proj})
+    for (int i = 0; i < 4; ++i)
+      for (int j = 0; j < 4; ++j)
+        h.addQuantized(m->m[i][j]);
+  h.addQuantized(desc.nearZ);
+  h.addValue(desc.mode);
+  h.add(desc.color, sizeof(desc.color));
+  h.addString(variant);
+  return h.finish();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Mesh.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 128-bit content hash; not cryptographic, but wide enough to name cache
+// entries without worrying about collisions.
+struct Hash128 {
+  uint64_t lo = 0, hi = 0;
+
+  std::string hex() const; // 32 lowercase hex digits
+  bool operator==(const Hash128 &o) const { return lo == o.lo && hi == o.hi; }
+  bool operator!=(const Hash128 &o) const { return !(*this == o); }
+};
+
+// Streaming hash in the style of xxHash64: four independent 64-bit lanes
+// take 32 bytes per step, so it runs at several GB/s and hashing a mesh
+// file costs about as much as reading it.
+class Hasher {
+public:
+  explicit Hasher(uint64_t seed = 0);
+
+  void add(const void *data, size_t size);
+  template <typename T> void addValue(const T &v) { add(&v, sizeof(v)); }
+  void addString(const std::string &s);
+  // Rounds away the 4 low mantissa bits (~1e-6 relative), so parameters
+  // computed slightly differently still give the same key
+  void addQuantized(float v);
+  Hash128 finish() const;
+
+private:
+  void consume(const uint8_t *block);
+
+  uint64_t m_lanes[4];
+  uint8_t m_buffer[32];
+  size_t m_buffered = 0;
+  uint64_t m_total = 0;
+};
+
+// Hash of a file's bytes; false if it can't be read.
+bool hashFile(const std::string &path, Hash128 &out);
+// Hash of everything the renderer reads from a mesh: vertices, edges, edge
+// kinds and the object ranges (names excluded).
+Hash128 hashMesh(const MeshView &mesh);
+
+// Key of one render: the mesh hash, every RenderDesc field that changes the
+// pixels (matrices and near plane quantized), and `variant` for anything
+// else the caller varies (output format, options, hidden objects).
+// Deadline-bounded renders depend on timing and should not be cached.
+Hash128 renderKey(const Hash128 &mesh, const RenderDesc &desc,
+                  const std::string &variant);
@@ -0,0 +1,137 @@
+#include "DiskCache.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+// Temporary files end in ".tmp-<pid>-<n>"; the scan skips them
+const char kTempTag[] = ".tmp-";
+
+std::string tempSuffix() {
+  static std::atomic<uint64_t> counter{0};
+#ifdef __unix__
+  const long pid = long(getpid());
+#else
+  const long pid = 0;
+#endif
+  return kTempTag + std::to_string(pid) + "-" + std::to_string(++counter);
+}
+} // namespace
+
+DiskCache::DiskCache(const std::string &directory, size_t maxBytes)
+    : m_directory((fs::path(directory) / kSubdirectory).string()),
+      m_maxBytes(maxBytes) {}
+
+// Picks up the entries already on disk, once. Needs m_mutex.
+void DiskCache::index() {
+  if (m_indexed)
+    return;
+  m_indexed = true;
+  std::vector<std::tuple<fs::file_time_type, std::string, size_t>> found;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(m_directory, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    if (!it->is_regular_file(ec))
+      continue;
+    const std::string name =
+        it->path().lexically_relative(m_directory).generic_string();
+    if (name.find(kTempTag) != std::string::npos)
+      continue;
+    found.emplace_back(it->last_write_time(ec), name,
+                       size_t(it->file_size(ec)));
+  }
+  std::sort(found.begin(), found.end());
+  for (const auto &f : found)
+    insert(std::get<1>(f), std::get<2>(f));
+}
+
+// Records a file as most recently used and deletes the least recently used
+// ones past the budget, always keeping the newest. Needs m_mutex.
+void DiskCache::insert(const std::string &name, size_t bytes) {
+  forget(name);
+  m_lru.push_front(name);
+  m_entries.emplace(name, Entry{bytes, m_lru.begin()});
+  m_bytes += bytes;
+  while (m_bytes > m_maxBytes && m_lru.size() > 1) {
+    const std::string victim = m_lru.back();
+    std::error_code ec;
+    fs::remove(fs::path(m_directory) / victim, ec);
+    forget(victim);
+    ++m_evictions;
+  }
+}
+
+void DiskCache::forget(const std::string &name) {
+  auto it = m_entries.find(name);
+  if (it == m_entries.end())
+    return;
+  m_bytes -= it->second.bytes;
+  m_lru.erase(it->second.lru);
+  m_entries.erase(it);
+}
+
+bool DiskCache::read(const std::string &name, std::vector<uint8_t> &out) {
+  const fs::path path = fs::path(m_directory) / name;
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  const std::streamoff size = f ? std::streamoff(f.tellg()) : -1;
+  if (size >= 0) {
+    out.resize(size_t(size));
+    f.seekg(0);
+    f.read(reinterpret_cast<char *>(out.data()), std::streamsize(size));
+  }
+  if (size < 0 || !f) {
+    // Never written, or deleted behind our back (another process evicted it)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    forget(name);
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(name);
+    if (it != m_entries.end())
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+  }
+  // Keeps the order across restarts
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+bool DiskCache::write(const std::string &name, const uint8_t *data,
+                      size_t size) {
+  const fs::path path = fs::path(m_directory) / name;
+  const fs::path tmp = path.string() + tempSuffix();
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  std::ofstream f(tmp, std::ios::binary);
+  f.write(reinterpret_cast<const char *>(data), std::streamsize(size));
+  f.close();
+  if (!f.good() || (fs::rename(tmp, path, ec), ec)) {
+    std::cerr << "Failed to write cache entry " << path.string() << "\n";
+    fs::remove(tmp, ec);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  index(); // finds the new entry too; insert() then counts it once
+  insert(name, size);
+  return true;
+}
+
+DiskCache::Stats DiskCache::stats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  index();
+  Stats s;
+  s.files = m_entries.size();
+  s.bytes = m_bytes;
+  s.evictions = m_evictions;
+  return s;
+}
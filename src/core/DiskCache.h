@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Size-bounded directory of cached files, named by relative paths; past the
+// budget the least recently used are deleted. Entries live in a subdirectory
+// of their own (kSubdirectory), so a cache pointed at a directory holding
+// other files never indexes or deletes them. Entries are written under a
+// temporary name and renamed into place, so readers in this or another
+// process never see a partial file. Each process keeps its own LRU order
+// (file mtimes carry it across restarts); an entry another process evicted
+// is simply a miss.
+class DiskCache {
+public:
+  struct Stats {
+    size_t files = 0, bytes = 0;
+    uint64_t evictions = 0;
+  };
+
+  static constexpr const char *kSubdirectory = "r3d-cache";
+
+  // Touches nothing: entries a previous run left are indexed, oldest first,
+  // and trimmed to the budget on the first write or stats() call, so a read
+  // costs one file open however many entries there are. The directory is
+  // created on the first write.
+  DiskCache(const std::string &directory, size_t maxBytes);
+  DiskCache(const DiskCache &) = delete;
+  DiskCache &operator=(const DiskCache &) = delete;
+
+  // Where the entries live: kSubdirectory of the directory passed in
+  const std::string &directory() const { return m_directory; }
+
+  // Reads entry `name` and marks it most recently used; false on a miss.
+  bool read(const std::string &name, std::vector<uint8_t> &out);
+  // Stores entry `name`; false on I/O errors.
+  bool write(const std::string &name, const uint8_t *data, size_t size);
+
+  Stats stats();
+
+private:
+  struct Entry {
+    size_t bytes;
+    std::list<std::string>::iterator lru;
+  };
+
+  void index();
+  void insert(const std::string &name, size_t bytes);
+  void forget(const std::string &name);
+
+  std::string m_directory;
+  size_t m_maxBytes;
+  mutable std::mutex m_mutex; // guards the index, not the files
+  bool m_indexed = false;
+  std::unordered_map<std::string, Entry> m_entries;
+  std::list<std::string> m_lru; // most recently used first
+  size_t m_bytes = 0;
+  uint64_t m_evictions = 0;
+};
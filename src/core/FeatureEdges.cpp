@@ -0,0 +1,155 @@
+#include "FeatureEdges.h"
+#include "Geometry.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr size_t kBucketBits = 12;
+constexpr size_t kBuckets = size_t(1) << kBucketBits;
+
+inline size_t bucketOf(uint64_t key) {
+  return size_t((key * 0x9E3779B97F4A7C15ull) >> (64 - kBucketBits));
+}
+
+struct KeyRef {
+  uint64_t key;
+  uint32_t ref; // face or edge index
+  bool operator<(const KeyRef &o) const { return key < o.key; }
+};
+
+// Scatters the KeyRefs produced by emit(i, sink) for i in [0, n) into one
+// array grouped by bucket; bucket b is [starts[b], starts[b+1]). Two passes
+// (count, then write) over the same ranges keep it deterministic.
+template <typename Emit>
+LargeVector<KeyRef> scatter(size_t n, Emit &&emit,
+                            std::vector<size_t> &starts) {
+  const size_t maxRanges = size_t(ThreadPool::shared().size() + 1) * 4;
+  const size_t nRanges = std::max<size_t>(1, std::min(n / 4096, maxRanges));
+  const size_t step = (n + nRanges - 1) / nRanges;
+  std::vector<size_t> counts(nRanges * kBuckets, 0);
+
+  parallelFor(0, nRanges, 1, [&](size_t lo, size_t hi) {
+    for (size_t r = lo; r < hi; ++r) {
+      size_t *c = &counts[r * kBuckets];
+      const size_t end = std::min(n, (r + 1) * step);
+      for (size_t i = r * step; i < end; ++i)
+        emit(i, [c](uint64_t key, uint32_t) { ++c[bucketOf(key)]; });
+    }
+  });
+
+  // Bucket-major offsets: bucket b of range r starts after all earlier
+  // buckets and after bucket b of earlier ranges
+  starts.assign(kBuckets + 1, 0);
+  size_t total = 0;
+  for (size_t b = 0; b < kBuckets; ++b) {
+    starts[b] = total;
+    for (size_t r = 0; r < nRanges; ++r) {
+      const size_t c = counts[r * kBuckets + b];
+      counts[r * kBuckets + b] = total;
+      total += c;
+    }
+  }
+  starts[kBuckets] = total;
+
+  LargeVector<KeyRef> out(total);
+  parallelFor(0, nRanges, 1, [&](size_t lo, size_t hi) {
+    for (size_t r = lo; r < hi; ++r) {
+      size_t *at = &counts[r * kBuckets];
+      const size_t end = std::min(n, (r + 1) * step);
+      for (size_t i = r * step; i < end; ++i)
+        emit(i, [&out, at](uint64_t key, uint32_t ref) {
+          out[at[bucketOf(key)]++] = {key, ref};
+        });
+    }
+  });
+  return out;
+}
+
+// Newell's method: robust for non-planar and non-convex polygons
+Vec3f faceNormal(const Mesh &mesh, const FaceList &faces, size_t f) {
+  const int nv = int(mesh.vertices.size());
+  const size_t b = faces.starts[f], e = faces.starts[f + 1];
+  Vec3f n{0.f, 0.f, 0.f};
+  for (size_t i = b; i < e; ++i) {
+    const int ia = faces.indices[i];
+    const int ib = faces.indices[i + 1 < e ? i + 1 : b];
+    if (ia < 0 || ia >= nv || ib < 0 || ib >= nv)
+      return {0.f, 0.f, 0.f};
+    const Vec3f &p = mesh.vertices[ia], &q = mesh.vertices[ib];
+    n.x += (p.y - q.y) * (p.z + q.z);
+    n.y += (p.z - q.z) * (p.x + q.x);
+    n.z += (p.x - q.x) * (p.y + q.y);
+  }
+  return normalize(n);
+}
+} // namespace
+
+void classifyEdges(Mesh &mesh, const FaceList &faces, float creaseDeg) {
+  const size_t nFaces = faces.size();
+  const size_t nEdges = mesh.edges.size();
+
+  LargeVector<Vec3f> normals(nFaces);
+  parallelFor(0, nFaces, 4096, [&](size_t lo, size_t hi) {
+    for (size_t f = lo; f < hi; ++f)
+      normals[f] = faceNormal(mesh, faces, f);
+  });
+
+  std::vector<size_t> faceStarts, edgeStarts;
+  LargeVector<KeyRef> faceEdges = scatter(
+      nFaces,
+      [&](size_t f, auto &&sink) {
+        const size_t b = faces.starts[f], e = faces.starts[f + 1];
+        for (size_t i = b; i < e; ++i) {
+          const int u = faces.indices[i];
+          const int v = faces.indices[i + 1 < e ? i + 1 : b];
+          if (u != v)
+            sink(edgeKey(u, v), uint32_t(f));
+        }
+      },
+      faceStarts);
+  LargeVector<KeyRef> edgeRefs = scatter(
+      nEdges,
+      [&](size_t i, auto &&sink) {
+        sink(edgeKey(mesh.edges[i].first, mesh.edges[i].second), uint32_t(i));
+      },
+      edgeStarts);
+
+  const float cosCrease = std::cos(creaseDeg * 3.14159265f / 180.f);
+  mesh.edgeKinds.assign(nEdges, EdgeKind::Boundary);
+  parallelFor(0, kBuckets, 1, [&](size_t lo, size_t hi) {
+    for (size_t b = lo; b < hi; ++b) {
+      KeyRef *f = faceEdges.data() + faceStarts[b];
+      KeyRef *fEnd = faceEdges.data() + faceStarts[b + 1];
+      KeyRef *e = edgeRefs.data() + edgeStarts[b];
+      KeyRef *eEnd = edgeRefs.data() + edgeStarts[b + 1];
+      std::sort(f, fEnd);
+      std::sort(e, eEnd);
+      for (; e < eEnd; ++e) {
+        while (f < fEnd && f->key < e->key)
+          ++f;
+        const KeyRef *run = f;
+        while (f < fEnd && f->key == e->key)
+          ++f;
+        const size_t count = size_t(f - run);
+        EdgeKind kind = EdgeKind::Boundary;
+        if (count == 2) {
+          const Vec3f &n0 = normals[run[0].ref], &n1 = normals[run[1].ref];
+          const bool degenerate = dot(n0, n0) == 0.f || dot(n1, n1) == 0.f;
+          kind = !degenerate && dot(n0, n1) >= cosCrease ? EdgeKind::Smooth
+                                                         : EdgeKind::Crease;
+        } else if (count > 2) {
+          kind = EdgeKind::NonManifold;
+        }
+        mesh.edgeKinds[e->ref] = kind;
+      }
+    }
+  });
+
+  mesh.featureEdges.clear();
+  for (size_t i = 0; i < nEdges; ++i)
+    if (mesh.edgeKinds[i] != EdgeKind::Smooth)
+      mesh.featureEdges.push_back(uint32_t(i));
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "HugePages.h"
+#include "Mesh.h"
+#include <cstddef>
+
+// Polygons as vertex index lists: face f is indices[starts[f], starts[f+1]).
+struct FaceList {
+  LargeVector<int> indices;
+  LargeVector<size_t> starts; // one more entry than there are faces
+
+  size_t size() const { return starts.empty() ? 0 : starts.size() - 1; }
+};
+
+// Fills mesh.edgeKinds and mesh.featureEdges from the faces the edges were
+// built from. An edge is Smooth when exactly two faces meet at it with
+// normals less than `creaseDeg` apart (so face windings must agree), a
+// Boundary with one face, NonManifold with more, and a Crease otherwise.
+//
+// Edge-face adjacency is built in parallel without a global hash table: face
+// edges and mesh edges are scattered into buckets by key, and each bucket is
+// sorted and joined on its own.
+void classifyEdges(Mesh &mesh, const FaceList &faces, float creaseDeg);
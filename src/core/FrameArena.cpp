@@ -0,0 +1,83 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+namespace {
+std::byte *allocBlock(size_t bytes) {
+  return static_cast<std::byte *>(
+      ::operator new(bytes, std::align_val_t(FrameArena::kCacheLine)));
+}
+} // namespace
+
+void FrameArena::Local::AlignedFree::operator()(std::byte *p) const {
+  ::operator delete(p, std::align_val_t(kCacheLine));
+}
+
+FrameArena::FrameArena(ThreadPool &pool, size_t blockBytes) : m_pool(pool) {
+  m_locals.resize(pool.size() + 1);
+  for (auto &l : m_locals) {
+    l = std::make_unique<Local>();
+    l->m_blockBytes = blockBytes;
+  }
+}
+
+FrameArena::Local &FrameArena::local() {
+  return *m_locals[size_t(m_pool.currentWorker() + 1)];
+}
+
+void *FrameArena::Local::allocate(size_t bytes, size_t align) {
+  if (!m_blocks.empty()) {
+    Block &b = m_blocks.back();
+    size_t at = (m_offset + align - 1) & ~(align - 1);
+    if (at + bytes <= b.size) {
+      m_offset = at + bytes;
+      m_used += bytes;
+      return b.mem.get() + at;
+    }
+  }
+  // Out of room: start a new block (never smaller than the request)
+  Block b;
+  b.size = std::max(m_blockBytes, (bytes + kCacheLine - 1) & ~(kCacheLine - 1));
+  b.mem.reset(allocBlock(b.size));
+  m_reserved += b.size;
+  m_blocks.push_back(std::move(b));
+  m_offset = bytes;
+  m_used += bytes;
+  return m_blocks.back().mem.get();
+}
+
+void FrameArena::Local::reset() {
+  if (m_blocks.size() > 1) {
+    // The frame overflowed its first block: replace all blocks with one
+    // large enough for the whole frame
+    size_t total = 0;
+    for (const auto &b : m_blocks)
+      total += b.size;
+    m_blocks.clear();
+    Block b;
+    b.size = total;
+    b.mem.reset(allocBlock(total));
+    m_blocks.push_back(std::move(b));
+    m_reserved = total;
+  }
+  m_offset = 0;
+  m_used = 0;
+}
+
+void FrameArena::reset() {
+  for (auto &l : m_locals)
+    l->reset();
+}
+
+size_t FrameArena::bytesUsed() const {
+  size_t n = 0;
+  for (const auto &l : m_locals)
+    n += l->bytesUsed();
+  return n;
+}
+
+size_t FrameArena::bytesReserved() const {
+  size_t n = 0;
+  for (const auto &l : m_locals)
+    n += l->bytesReserved();
+  return n;
+}
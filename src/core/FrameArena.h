@@ -0,0 +1,83 @@
+#pragma once
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Contiguous view of arena memory; valid until the owning arena is reset.
+template <typename T> struct ArenaSpan {
+  T *data = nullptr;
+  size_t size = 0;
+
+  T *begin() const { return data; }
+  T *end() const { return data + size; }
+  T &operator[](size_t i) const { return data[i]; }
+  bool empty() const { return size == 0; }
+};
+
+// Bump allocator for per-frame scratch. Every thread of the pool gets its own
+// cache-line aligned sub-arena, so parallel stages allocate without locks or
+// false sharing. reset() rewinds all sub-arenas and folds each one's blocks
+// into a single block sized to what the frame used, so steady-state frames
+// do no heap allocation at all.
+//
+// One arena serves one render context: its owning thread plus pool workers.
+// Any thread outside the pool maps to the owner's sub-arena, so concurrent
+// render contexts each need their own arena.
+class FrameArena {
+public:
+  static constexpr size_t kCacheLine = 64;
+
+  explicit FrameArena(ThreadPool &pool = ThreadPool::shared(),
+                      size_t blockBytes = size_t(256) << 10);
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  class alignas(kCacheLine) Local {
+  public:
+    void *allocate(size_t bytes, size_t align = kCacheLine);
+    // Uninitialised storage for n trivially destructible objects.
+    template <typename T> T *alloc(size_t n) {
+      static_assert(std::is_trivially_destructible<T>::value,
+                    "arena memory is never destroyed");
+      return static_cast<T *>(
+          allocate(n * sizeof(T), std::max(alignof(T), kCacheLine)));
+    }
+    template <typename T> ArenaSpan<T> span(size_t n) { return {alloc<T>(n), n}; }
+
+    size_t bytesUsed() const { return m_used; }
+    size_t bytesReserved() const { return m_reserved; }
+
+  private:
+    friend class FrameArena;
+    struct AlignedFree {
+      void operator()(std::byte *p) const;
+    };
+    struct Block {
+      std::unique_ptr<std::byte, AlignedFree> mem; // aligned to kCacheLine
+      size_t size = 0;
+    };
+    void reset();
+
+    size_t m_blockBytes = 0;
+    std::vector<Block> m_blocks;
+    size_t m_offset = 0; // into m_blocks.back()
+    size_t m_used = 0;   // bytes handed out since reset, across blocks
+    size_t m_reserved = 0;
+  };
+
+  // Sub-arena of the calling thread (pool worker or the owning thread).
+  Local &local();
+  void reset();
+
+  size_t bytesUsed() const;
+  size_t bytesReserved() const;
+
+private:
+  ThreadPool &m_pool;
+  std::vector<std::unique_ptr<Local>> m_locals; // [0] owner, [i+1] worker i
+};
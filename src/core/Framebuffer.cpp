@@ -0,0 +1,96 @@
+#include "Framebuffer.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+int tilesAcross(int n) { return (n + kPixelTile - 1) / kPixelTile; }
+} // namespace
+
+Framebuffer::Framebuffer(int W, int H, uint8_t r, uint8_t g, uint8_t b,
+                         PixelLayout layout_)
+    : w(W), h(H), layout(layout_),
+      data(layout_ == PixelLayout::RowMajor
+               ? size_t(W) * H * 3
+               : size_t(tilesAcross(W)) * tilesAcross(H) * kPixelTileBytes) {
+  for (size_t i = 0, n = data.size() / 3; i < n; ++i) {
+    data[3 * i + 0] = r;
+    data[3 * i + 1] = g;
+    data[3 * i + 2] = b;
+  }
+}
+
+size_t Framebuffer::stride() const {
+  return layout == PixelLayout::RowMajor
+             ? size_t(w) * 3
+             : size_t(tilesAcross(w)) * kPixelTileBytes;
+}
+
+void copyRows(const PixelView &src, int y0, int rows, uint8_t *dst,
+              size_t dstStride) {
+  const size_t rowBytes = size_t(src.w) * 3;
+  if (src.layout == PixelLayout::RowMajor) {
+    for (int y = y0; y < y0 + rows; ++y, dst += dstStride)
+      std::memcpy(dst, src.data + size_t(y) * src.stride, rowBytes);
+    return;
+  }
+  const size_t tileRowBytes = kPixelTile * 3;
+  const int whole = src.w / kPixelTile;
+  for (int y = y0; y < y0 + rows; ++y, dst += dstStride) {
+    const uint8_t *in = src.data + src.offset(0, y);
+    uint8_t *out = dst;
+    // Fixed-size copies compile to a pair of vector moves
+    for (int t = 0; t < whole; ++t) {
+      std::memcpy(out, in, tileRowBytes);
+      in += kPixelTileBytes;
+      out += tileRowBytes;
+    }
+    std::memcpy(out, in, rowBytes - size_t(whole) * tileRowBytes);
+  }
+}
+
+void drawLine(const PixelView &im, int x0, int y0, int x1, int y1, uint8_t r,
+              uint8_t g, uint8_t b) {
+  auto plot = [r, g, b](uint8_t *p) {
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+  };
+  if (im.layout == PixelLayout::RowMajor) {
+    forEachLinePixel(x0, y0, x1, y1, im.w, im.h, [&](int x, int y) {
+      plot(im.data + size_t(y) * im.stride + size_t(x) * 3);
+    });
+  } else {
+    forEachLinePixel(x0, y0, x1, y1, im.w, im.h, [&](int x, int y) {
+      plot(im.data + im.offset(x, y));
+    });
+  }
+}
+
+bool savePPM(const std::string &path, const Framebuffer &img) {
+  R3D_PROBE2(encode_start, "ppm", img.data.size());
+  std::ofstream f(path, std::ios::binary);
+  if (f) {
+    f << "P6\n" << img.w << " " << img.h << "\n255\n";
+    if (img.layout == PixelLayout::RowMajor) {
+      f.write(reinterpret_cast<const char *>(img.data.data()),
+              std::streamsize(img.data.size()));
+    } else {
+      // A band of tile rows at a time, never a second full image
+      const PixelView v = img.view();
+      const size_t rowBytes = size_t(img.w) * 3;
+      std::vector<uint8_t> band(rowBytes * kPixelTile);
+      for (int y = 0; y < img.h && f; y += kPixelTile) {
+        const int rows = std::min(kPixelTile, img.h - y);
+        copyRows(v, y, rows, band.data(), rowBytes);
+        f.write(reinterpret_cast<const char *>(band.data()),
+                std::streamsize(rowBytes * size_t(rows)));
+      }
+    }
+  }
+  const bool ok = f.good();
+  R3D_PROBE2(encode_end, "ppm", ok);
+  return ok;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "HugePages.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+// How pixels are laid out in memory. Row-major is what encoders and
+// embedders expect. Tiled8 stores 8x8-pixel blocks contiguously (192 bytes,
+// three cache lines), so a steep line touches one block per 8 rows instead
+// of a cache line, and often a page, per row; it is converted to row-major
+// when the image is encoded (copyRows).
+enum class PixelLayout : uint8_t { RowMajor, Tiled8 };
+constexpr int kPixelTile = 8;
+constexpr size_t kPixelTileBytes = kPixelTile * kPixelTile * 3;
+
+// Non-owning RGB8 pixels (3 bytes per pixel), e.g. a Framebuffer or a buffer
+// handed in by an embedder. `stride` is the bytes per row, or per row of
+// tiles when tiled.
+struct PixelView {
+  uint8_t *data = nullptr;
+  int w = 0, h = 0;
+  size_t stride = 0;
+  PixelLayout layout = PixelLayout::RowMajor;
+
+  inline size_t offset(int x, int y) const {
+    if (layout == PixelLayout::RowMajor)
+      return size_t(y) * stride + size_t(x) * 3;
+    const unsigned ux = unsigned(x), uy = unsigned(y);
+    return (uy / kPixelTile) * stride + (ux / kPixelTile) * kPixelTileBytes +
+           (uy % kPixelTile) * (kPixelTile * 3) + (ux % kPixelTile) * 3;
+  }
+  inline void put(int x, int y, uint8_t r, uint8_t g, uint8_t b) const {
+    if (x < 0 || y < 0 || x >= w || y >= h)
+      return;
+    uint8_t *p = data + offset(x, y);
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+  }
+};
+
+// RGB image (3 bytes per pixel) that lines are rasterized into.
+// Poster-size renders run to gigabytes, so pixels live in huge pages.
+struct Framebuffer {
+  int w = 0, h = 0;
+  PixelLayout layout = PixelLayout::RowMajor;
+  // w*h*3 bytes; whole tiles (edges padded) when tiled
+  LargeVector<uint8_t> data;
+
+  Framebuffer(int W, int H, uint8_t r, uint8_t g, uint8_t b,
+              PixelLayout layout = PixelLayout::RowMajor);
+  inline void put(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+    view().put(x, y, r, g, b);
+  }
+  size_t stride() const;
+  PixelView view() { return {data.data(), w, h, stride(), layout}; }
+  PixelView view() const {
+    return {const_cast<uint8_t *>(data.data()), w, h, stride(), layout};
+  }
+};
+
+// Copies rows [y0, y0 + rows) of `src`, in either layout, into row-major
+// `dst`; tiled rows go 24 bytes (one tile row) per copy.
+void copyRows(const PixelView &src, int y0, int rows, uint8_t *dst,
+              size_t dstStride);
+
+// Calls plot(x, y) for every pixel of the integer Bresenham line that lies
+// in [0, w) x [0, h). The walk starts and stops at the viewport along the
+// major axis, with the error term advanced in closed form, so the pixels are
+// exactly those of the full walk but lines far off-screen cost nothing.
+template <typename Plot>
+inline void forEachLinePixel(int x0, int y0, int x1, int y1, int w, int h,
+                             Plot &&plot) {
+  bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+    std::swap(w, h);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+
+  int dx = x1 - x0;
+  int dy = std::abs(y1 - y0);
+  int ystep = (y0 < y1) ? 1 : -1;
+
+  // Steps [first, last] of the walk that fall inside [0, w)
+  const int64_t first = std::max<int64_t>(0, -int64_t(x0));
+  const int64_t last = std::min<int64_t>(dx, int64_t(w) - 1 - x0);
+  if (first > last)
+    return;
+  // After k steps y has moved ceil((k*dy - dx/2) / dx) times
+  int64_t err = dx / 2 - first * dy, moves = 0;
+  if (err < 0) {
+    moves = (-err + dx - 1) / dx;
+    err += moves * dx;
+  }
+  int y = int(y0 + moves * ystep);
+
+  for (int x = int(x0 + first); x <= int(x0 + last); ++x) {
+    if (unsigned(y) < unsigned(h)) {
+      if (steep)
+        plot(y, x);
+      else
+        plot(x, y);
+    }
+    err -= dy;
+    if (err < 0) {
+      y += ystep;
+      err += dx;
+    }
+  }
+}
+
+// integer Bresenham
+void drawLine(const PixelView &im, int x0, int y0, int x1, int y1, uint8_t r,
+              uint8_t g, uint8_t b);
+inline void drawLine(Framebuffer &im, int x0, int y0, int x1, int y1,
+                     uint8_t r, uint8_t g, uint8_t b) {
+  drawLine(im.view(), x0, y0, x1, y1, r, g, b);
+}
+
+bool savePPM(const std::string &path, const Framebuffer &img);
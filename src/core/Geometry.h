@@ -1,7 +1,11 @@
 #pragma once
+#include "HugePages.h"
+#include "Math.h"
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
-#include <unordered_set>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -11,14 +15,151 @@ inline uint64_t edgeKey(int a, int b) {
   return (uint64_t(a) << 32) | uint32_t(b);
 }
 
+// Open-addressing set of edge keys. Key 0 (the degenerate edge 0-0, which
+// is never stored) marks empty slots.
+class EdgeKeySet {
+public:
+  explicit EdgeKeySet(size_t expected = 0) { rehash(expected); }
+
+  // Returns true if the key was not present yet
+  bool insert(uint64_t key) {
+    if ((m_size + 1) * 2 > m_slots.size())
+      rehash(m_size * 2 + 1);
+    size_t i = slot(key);
+    while (m_slots[i] != 0) {
+      if (m_slots[i] == key)
+        return false;
+      i = (i + 1) & m_mask;
+    }
+    m_slots[i] = key;
+    ++m_size;
+    return true;
+  }
+  size_t size() const { return m_size; }
+
+private:
+  size_t slot(uint64_t key) const {
+    return size_t((key * 0x9E3779B97F4A7C15ull) >> 20) & m_mask;
+  }
+  void rehash(size_t expected) {
+    size_t cap = 16;
+    while (cap < expected * 2)
+      cap <<= 1;
+    LargeVector<uint64_t> old;
+    old.swap(m_slots);
+    m_slots.assign(cap, 0);
+    m_mask = cap - 1;
+    for (uint64_t k : old) {
+      if (k == 0)
+        continue;
+      size_t i = slot(k);
+      while (m_slots[i] != 0)
+        i = (i + 1) & m_mask;
+      m_slots[i] = k;
+    }
+  }
+
+  LargeVector<uint64_t> m_slots; // random probes: keep them in huge pages
+  size_t m_mask = 0;
+  size_t m_size = 0;
+};
+
 template <typename EdgeArray> inline void dedupEdges(EdgeArray &edges) {
-  std::unordered_set<uint64_t> seen;
+  EdgeKeySet seen(edges.size() / 2);
   std::vector<std::pair<int, int>> unique;
   unique.reserve(edges.size());
   for (const auto &e : edges) {
     auto k = edgeKey(e.first, e.second);
-    if (seen.insert(k).second)
+    if (seen.insert(k))
       unique.push_back(e);
   }
   edges.assign(unique.begin(), unique.end());
 }
+
+// Axis-aligned bounding box; empty until the first expand().
+struct Bounds {
+  Vec3f min{std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::infinity()};
+  Vec3f max{-std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity()};
+
+  bool empty() const { return min.x > max.x; }
+  void expand(const Vec3f &p) {
+    min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+    max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+  }
+  Vec3f center() const { return (min + max) * 0.5f; }
+  // Radius of the bounding sphere around center().
+  float radius() const { return empty() ? 0.f : length(max - min) * 0.5f; }
+};
+
+// View frustum as clip-space planes (Gribb/Hartmann) of an OpenGL-style
+// matrix such as proj * view, normalised so that dot(n, p) + d is a distance
+// and inside is >= 0. Planes are left, right, bottom, top, near, far.
+struct Frustum {
+  Vec4f planes[6];
+
+  explicit Frustum(const Mat4 &m) {
+    for (int i = 0; i < 3; ++i) {
+      for (int s = 0; s < 2; ++s) {
+        const float sign = s ? -1.f : 1.f;
+        Vec4f p{m.m[3][0] + sign * m.m[i][0], m.m[3][1] + sign * m.m[i][1],
+                m.m[3][2] + sign * m.m[i][2], m.m[3][3] + sign * m.m[i][3]};
+        const float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        if (len > 0.f)
+          p = {p.x / len, p.y / len, p.z / len, p.w / len};
+        planes[2 * i + s] = p;
+      }
+    }
+  }
+
+  // True if the box lies wholly outside one of the first `count` planes;
+  // count = 4 tests the side planes only.
+  bool outside(const Bounds &b, int count = 6) const {
+    for (int i = 0; i < count; ++i) {
+      const Vec4f &p = planes[i];
+      // Corner furthest along the plane normal
+      const float d = p.x * (p.x > 0.f ? b.max.x : b.min.x) +
+                      p.y * (p.y > 0.f ? b.max.y : b.min.y) +
+                      p.z * (p.z > 0.f ? b.max.z : b.min.z) + p.w;
+      if (d < 0.f)
+        return true;
+    }
+    return false;
+  }
+
+  bool outside(const Vec3f &c, float r) const {
+    for (const Vec4f &p : planes)
+      if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -r)
+        return true;
+    return false;
+  }
+};
+
+// Liang-Barsky clip of segment ab to [0, w] x [0, h]; false if it misses
+inline bool clipToViewport(Vec2f &a, Vec2f &b, float w, float h) {
+  const float dx = b.x - a.x, dy = b.y - a.y;
+  const float p[4] = {-dx, dx, -dy, dy};
+  const float q[4] = {a.x, w - a.x, a.y, h - a.y};
+  float t0 = 0.f, t1 = 1.f;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0.f) {
+      if (q[i] < 0.f)
+        return false;
+      continue;
+    }
+    const float t = q[i] / p[i];
+    if (p[i] < 0.f)
+      t0 = std::max(t0, t);
+    else
+      t1 = std::min(t1, t);
+    if (t0 > t1)
+      return false;
+  }
+  const Vec2f a0 = a;
+  a = {a0.x + t0 * dx, a0.y + t0 * dy};
+  b = {a0.x + t1 * dx, a0.y + t1 * dy};
+  return true;
+}
@@ -0,0 +1,93 @@
+#include "HugePages.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+std::atomic<size_t> mappedBytes{0};
+
+bool envFlag(const char *name, bool dflt) {
+  const char *v = std::getenv(name);
+  return v ? std::strcmp(v, "0") != 0 : dflt;
+}
+
+#ifdef __linux__
+bool hugePagesEnabled() {
+  static const bool on = envFlag("R3D_HUGEPAGES", true);
+  return on;
+}
+
+bool hugeTlbEnabled() {
+  static const bool on = envFlag("R3D_HUGETLB", false);
+  return on;
+}
+
+size_t roundUp(size_t bytes) {
+  return (bytes + kHugePageBytes - 1) & ~(kHugePageBytes - 1);
+}
+
+// Maps `len` bytes (a multiple of 2 MB) on a 2 MB boundary
+void *mapAligned(size_t len) {
+  if (hugeTlbEnabled()) {
+    void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+      return p;
+  }
+  // Over-map by one huge page and trim both ends to the aligned window
+  const size_t span = len + kHugePageBytes;
+  void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return nullptr;
+  const uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+  const uintptr_t aligned = (base + kHugePageBytes - 1) & ~(kHugePageBytes - 1);
+  if (aligned > base)
+    munmap(raw, aligned - base);
+  if (const size_t tail = base + span - (aligned + len))
+    munmap(reinterpret_cast<void *>(aligned + len), tail);
+  void *p = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(p, len, MADV_HUGEPAGE); // best effort: THP may be disabled
+#endif
+  return p;
+}
+#endif
+} // namespace
+
+void *hugePageAlloc(size_t bytes) {
+#ifdef __linux__
+  if (bytes >= kHugePageBytes && hugePagesEnabled()) {
+    const size_t len = roundUp(bytes);
+    void *p = mapAligned(len);
+    if (!p)
+      throw std::bad_alloc();
+    mappedBytes.fetch_add(len, std::memory_order_relaxed);
+    return p;
+  }
+#endif
+  return ::operator new(bytes);
+}
+
+void hugePageFree(void *p, size_t bytes) {
+  if (!p)
+    return;
+#ifdef __linux__
+  if (bytes >= kHugePageBytes && hugePagesEnabled()) {
+    const size_t len = roundUp(bytes);
+    munmap(p, len);
+    mappedBytes.fetch_sub(len, std::memory_order_relaxed);
+    return;
+  }
+#endif
+  ::operator delete(p);
+}
+
+size_t hugePageBytesMapped() {
+  return mappedBytes.load(std::memory_order_relaxed);
+}
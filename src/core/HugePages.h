@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Allocation for large arrays (mesh vertices/edges, framebuffers) that are
+// read with random access, where 4 KB pages thrash the TLB. Requests of at
+// least kHugePageBytes are mapped 2 MB-aligned and advised as transparent
+// huge pages (madvise(MADV_HUGEPAGE)); with R3D_HUGETLB=1 explicit huge pages
+// (MAP_HUGETLB) are tried first. Smaller requests, non-Linux builds and
+// R3D_HUGEPAGES=0 fall back to operator new.
+constexpr size_t kHugePageBytes = size_t(2) << 20;
+
+void *hugePageAlloc(size_t bytes);
+void hugePageFree(void *p, size_t bytes);
+// Bytes currently held in 2 MB-aligned mappings.
+size_t hugePageBytesMapped();
+
+template <typename T> struct HugePageAllocator {
+  using value_type = T;
+
+  HugePageAllocator() = default;
+  template <typename U> HugePageAllocator(const HugePageAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(hugePageAlloc(n * sizeof(T)));
+  }
+  void deallocate(T *p, size_t n) { hugePageFree(p, n * sizeof(T)); }
+
+  template <typename U> bool operator==(const HugePageAllocator<U> &) const {
+    return true;
+  }
+  template <typename U> bool operator!=(const HugePageAllocator<U> &) const {
+    return false;
+  }
+};
+
+template <typename T> using LargeVector = std::vector<T, HugePageAllocator<T>>;
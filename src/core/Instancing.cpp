@@ -0,0 +1,229 @@
+#include "Instancing.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+const uint32_t kLeafSize = 4;
+
+Vec3f transformPoint(const Mat4 &m, const Vec3f &p) {
+  Vec4f r = mul(m, {p.x, p.y, p.z, 1.f});
+  return {r.x, r.y, r.z};
+}
+
+// Largest axis scale of the upper 3x3, so spheres stay conservative
+float maxScale(const Mat4 &m) {
+  float s = 0.f;
+  for (int c = 0; c < 3; ++c)
+    s = std::max(s, std::sqrt(m.m[0][c] * m.m[0][c] + m.m[1][c] * m.m[1][c] +
+                              m.m[2][c] * m.m[2][c]));
+  return s;
+}
+
+Vec3f corner(const Bounds &b, int i) {
+  return {(i & 1) ? b.max.x : b.min.x, (i & 2) ? b.max.y : b.min.y,
+          (i & 4) ? b.max.z : b.min.z};
+}
+
+float axis(const Vec3f &v, int a) { return a == 0 ? v.x : a == 1 ? v.y : v.z; }
+} // namespace
+
+InstanceSet::InstanceSet(MeshHandle mesh, std::vector<Mat4> transforms)
+    : m_mesh(std::move(mesh)), m_transforms(std::move(transforms)) {
+  const size_t n = m_transforms.size();
+  const Bounds local = m_mesh->bounds();
+  const Vec3f localCenter = local.center();
+  const float localRadius = local.radius();
+
+  std::vector<Bounds> boxes(n);
+  m_centers.resize(n);
+  m_radii.resize(n);
+  parallelFor(0, n, 1024, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i) {
+      const Mat4 &t = m_transforms[i];
+      m_centers[i] = transformPoint(t, localCenter);
+      m_radii[i] = localRadius * maxScale(t);
+      if (!local.empty())
+        for (int c = 0; c < 8; ++c)
+          boxes[i].expand(transformPoint(t, corner(local, c)));
+    }
+  });
+
+  if (n == 0 || local.empty())
+    return;
+  m_order.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    m_order[i] = uint32_t(i);
+  m_nodes.reserve(2 * (n / kLeafSize + 1));
+  m_nodes.emplace_back();
+  build(0, 0, uint32_t(n), boxes);
+  m_bounds = m_nodes[0].box;
+}
+
+void InstanceSet::build(uint32_t node, uint32_t begin, uint32_t end,
+                        const std::vector<Bounds> &boxes) {
+  Bounds box, centers;
+  float maxRadius = 0.f;
+  for (uint32_t i = begin; i < end; ++i) {
+    const uint32_t k = m_order[i];
+    box.expand(boxes[k].min);
+    box.expand(boxes[k].max);
+    centers.expand(m_centers[k]);
+    maxRadius = std::max(maxRadius, m_radii[k]);
+  }
+  m_nodes[node].box = box;
+  m_nodes[node].maxRadius = maxRadius;
+  if (end - begin <= kLeafSize) {
+    m_nodes[node].first = begin;
+    m_nodes[node].count = end - begin;
+    return;
+  }
+
+  // Median split along the widest spread of instance centres
+  const Vec3f ext = centers.max - centers.min;
+  const int a = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+  const uint32_t mid = begin + (end - begin) / 2;
+  std::nth_element(m_order.begin() + begin, m_order.begin() + mid,
+                   m_order.begin() + end, [&](uint32_t x, uint32_t y) {
+                     return axis(m_centers[x], a) < axis(m_centers[y], a);
+                   });
+
+  const uint32_t left = uint32_t(m_nodes.size());
+  m_nodes.emplace_back();
+  m_nodes.emplace_back();
+  m_nodes[node].first = left;
+  build(left, begin, mid, boxes);
+  build(left + 1, mid, end, boxes);
+}
+
+ArenaSpan<VisibleInstance> InstanceSet::cull(const RenderDesc &desc,
+                                             const InstanceCullOptions &opt,
+                                             FrameArena &arena) const {
+  ArenaSpan<VisibleInstance> out =
+      arena.local().span<VisibleInstance>(m_order.size());
+  out.size = 0;
+  if (m_nodes.empty())
+    return out;
+
+  const Mat4 vp = desc.proj * desc.view;
+  const Frustum frustum(vp);
+  // Projected radius is r * k / w, with w the clip-space w of the centre
+  // (view depth in perspective, 1 in orthographic)
+  const float k = std::abs(desc.proj.m[1][1]) * 0.5f * float(desc.height);
+  const float *w = vp.m[3];
+  auto clipW = [w](const Vec3f &p) {
+    return w[0] * p.x + w[1] * p.y + w[2] * p.z + w[3];
+  };
+
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node &node = m_nodes[stack[--top]];
+    if (frustum.outside(node.box))
+      continue;
+    // Smallest w over the box bounds how large any instance below can get
+    const Bounds &b = node.box;
+    const float wMin = w[3] + w[0] * (w[0] > 0.f ? b.min.x : b.max.x) +
+                       w[1] * (w[1] > 0.f ? b.min.y : b.max.y) +
+                       w[2] * (w[2] > 0.f ? b.min.z : b.max.z);
+    if (wMin > 0.f && node.maxRadius * k < opt.minPixels * wMin)
+      continue;
+
+    if (node.count == 0) {
+      stack[top++] = node.first + 1;
+      stack[top++] = node.first;
+      continue;
+    }
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      const uint32_t idx = m_order[i];
+      const Vec3f &c = m_centers[idx];
+      const float r = m_radii[idx];
+      if (frustum.outside(c, r))
+        continue;
+      const float cw = clipW(c);
+      const float px =
+          cw > r ? r * k / cw : std::numeric_limits<float>::infinity();
+      if (px < opt.minPixels)
+        continue;
+      out[out.size++] = {idx, px,
+                         px >= opt.fullPixels ? InstanceDetail::Full
+                                              : InstanceDetail::Box};
+    }
+  }
+  return out;
+}
+
+size_t InstanceSet::bytesUsed() const {
+  return m_transforms.size() * sizeof(Mat4) +
+         m_centers.size() * sizeof(Vec3f) + m_radii.size() * sizeof(float) +
+         m_order.size() * sizeof(uint32_t) + m_nodes.size() * sizeof(Node);
+}
+
+size_t InstanceSet::bytesReserved() const {
+  return m_transforms.capacity() * sizeof(Mat4) +
+         m_centers.capacity() * sizeof(Vec3f) +
+         m_radii.capacity() * sizeof(float) +
+         m_order.capacity() * sizeof(uint32_t) +
+         m_nodes.capacity() * sizeof(Node);
+}
+
+InstanceLines renderInstances(const RenderDesc &desc, const InstanceSet &set,
+                              const ArenaSpan<VisibleInstance> &visible,
+                              FrameArena &arena) {
+  static const std::pair<int, int> kBoxEdges[12] = {
+      {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3},
+      {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+  FrameArena::Local &scratch = arena.local();
+  Mat4 *full = scratch.alloc<Mat4>(visible.size);
+  Mat4 *boxes = scratch.alloc<Mat4>(visible.size);
+  size_t nFull = 0, nBoxes = 0;
+  for (const auto &v : visible) {
+    if (v.detail == InstanceDetail::Full)
+      full[nFull++] = set.transform(v.index);
+    else
+      boxes[nBoxes++] = set.transform(v.index);
+  }
+
+  const Bounds &b = set.mesh()->bounds();
+  Vec3f *corners = scratch.alloc<Vec3f>(8);
+  for (int i = 0; i < 8; ++i)
+    corners[i] = corner(b, i);
+  MeshView box;
+  box.vertices = corners;
+  box.vertexCount = 8;
+  box.edges = kBoxEdges;
+  box.edgeCount = b.empty() ? 0 : 12;
+
+  // Counters cover both passes
+  RenderStats boxStats;
+  RenderDesc boxDesc = desc;
+  boxDesc.stats = desc.stats ? &boxStats : nullptr;
+
+  InstanceLines out;
+  out.full = renderInstancedLines(desc, *set.mesh(), full, nFull, arena);
+  out.boxes = renderInstancedLines(boxDesc, box, boxes, nBoxes, arena);
+  if (desc.stats)
+    *desc.stats += boxStats;
+  return out;
+}
+
+std::vector<Mat4> gridTransforms(const Bounds &meshBounds, size_t count) {
+  const size_t side = size_t(std::ceil(std::sqrt(double(count))));
+  const float spacing = 3.f * std::max(meshBounds.radius(), 1e-3f);
+  const Vec3f c = meshBounds.empty() ? Vec3f{} : meshBounds.center();
+  const float origin = -0.5f * spacing * float(side > 0 ? side - 1 : 0);
+
+  std::vector<Mat4> out(count);
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3f at{origin + spacing * float(i % side), 0.f,
+                   origin + spacing * float(i / side)};
+    // Golden-angle yaws keep neighbours from looking identical
+    out[i] = Mat4::translation(at) * Mat4::rotationY(2.39996323f * float(i)) *
+             Mat4::translation(c * -1.f);
+  }
+  return out;
+}
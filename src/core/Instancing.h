@@ -0,0 +1,84 @@
+#pragma once
+#include "FrameArena.h"
+#include "Geometry.h"
+#include "Math.h"
+#include "Renderer.h"
+#include "SharedMesh.h"
+#include <cstdint>
+#include <vector>
+
+// How much of a visible instance gets drawn.
+enum class InstanceDetail : uint8_t {
+  Full, // every edge of the mesh
+  Box,  // the 12 edges of its transformed bounding box
+};
+
+struct VisibleInstance {
+  uint32_t index;    // into the InstanceSet
+  float pixelRadius; // projected radius of its bounding sphere
+  InstanceDetail detail;
+};
+
+struct InstanceCullOptions {
+  float minPixels = 1.0f;   // instances projecting smaller are skipped
+  float fullPixels = 24.0f; // ...and smaller than this are drawn as boxes
+};
+
+// Lines of one frame of instances; both spans live in the frame arena.
+struct InstanceLines {
+  ArenaSpan<ScreenLine> full, boxes;
+};
+
+// Many copies of one shared mesh, each with its own model matrix. Besides the
+// mesh handle it stores one transform and bounding sphere per copy, plus a
+// BVH over the copies' world bounds that lets cull() skip whole groups that
+// are off screen or too small; frame time follows the visible copies.
+class InstanceSet {
+public:
+  InstanceSet(MeshHandle mesh, std::vector<Mat4> transforms);
+
+  const MeshHandle &mesh() const { return m_mesh; }
+  size_t size() const { return m_transforms.size(); }
+  const Mat4 &transform(size_t i) const { return m_transforms[i]; }
+  // World bounds of all instances
+  const Bounds &bounds() const { return m_bounds; }
+  // Memory of the per-instance data and the BVH, without the mesh
+  size_t bytesUsed() const;
+  size_t bytesReserved() const;
+
+  // Instances inside the view frustum of desc (desc.model is ignored) and
+  // large enough on screen, with the detail to draw them at.
+  ArenaSpan<VisibleInstance> cull(const RenderDesc &desc,
+                                  const InstanceCullOptions &opt,
+                                  FrameArena &arena) const;
+
+private:
+  struct Node {
+    Bounds box;
+    float maxRadius = 0.f; // largest instance sphere below this node
+    uint32_t first = 0;    // leaf: into m_order; inner: left child, right next
+    uint32_t count = 0;    // instances of a leaf; 0 for inner nodes
+  };
+  void build(uint32_t node, uint32_t begin, uint32_t end,
+             const std::vector<Bounds> &boxes);
+
+  MeshHandle m_mesh;
+  std::vector<Mat4> m_transforms;
+  std::vector<Vec3f> m_centers; // world bounding spheres
+  std::vector<float> m_radii;
+  std::vector<uint32_t> m_order; // instances in leaf order
+  std::vector<Node> m_nodes;     // [0] is the root
+  Bounds m_bounds;
+};
+
+// Projects the visible instances, Full ones with every mesh edge and Box ones
+// with their bounding box, and rasterizes them into desc.target when set.
+// desc.stats, when set, sums both kinds of line.
+InstanceLines renderInstances(const RenderDesc &desc, const InstanceSet &set,
+                              const ArenaSpan<VisibleInstance> &visible,
+                              FrameArena &arena);
+
+// `count` copies laid out on a square grid in the XZ plane around the origin,
+// spaced three bounding radii apart and each turned to its own yaw. Used for
+// the apps' fleet views.
+std::vector<Mat4> gridTransforms(const Bounds &meshBounds, size_t count);
@@ -0,0 +1,152 @@
+#include "MemoryReport.h"
+#include "Instancing.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+std::string formatBytes(size_t bytes) {
+  static const char *const kUnits[] = {"B", "KB", "MB", "GB", "TB"};
+  double v = double(bytes);
+  int unit = 0;
+  while (v >= 1024.0 && unit < 4) {
+    v /= 1024.0;
+    ++unit;
+  }
+  std::ostringstream s;
+  s.setf(std::ios::fixed);
+  s.precision(unit == 0 ? 0 : 1);
+  s << v << " " << kUnits[unit];
+  return s.str();
+}
+
+// Value in bytes of a "Key:   1234 kB" line of /proc/self/status
+size_t procStatusBytes(const char *key) {
+#ifdef __linux__
+  std::ifstream f("/proc/self/status");
+  std::string line;
+  const size_t keyLen = std::strlen(key);
+  while (std::getline(f, line)) {
+    if (line.compare(0, keyLen, key) == 0 && line.size() > keyLen &&
+        line[keyLen] == ':') {
+      unsigned long long kb = 0;
+      if (std::sscanf(line.c_str() + keyLen + 1, "%llu", &kb) == 1)
+        return size_t(kb) * 1024;
+    }
+  }
+#else
+  (void)key;
+#endif
+  return 0;
+}
+} // namespace
+
+void MemoryReport::add(std::string subsystem, std::string name, size_t used,
+                       size_t reserved, bool detail) {
+  m_items.push_back({std::move(subsystem), std::move(name), used,
+                     std::max(used, reserved), detail});
+}
+
+size_t MemoryReport::used() const {
+  size_t n = 0;
+  for (const auto &i : m_items)
+    if (!i.detail)
+      n += i.used;
+  return n;
+}
+
+size_t MemoryReport::reserved() const {
+  size_t n = 0;
+  for (const auto &i : m_items)
+    if (!i.detail)
+      n += i.reserved;
+  return n;
+}
+
+size_t MemoryReport::reserved(const std::string &subsystem) const {
+  size_t n = 0;
+  for (const auto &i : m_items)
+    if (!i.detail && i.subsystem == subsystem)
+      n += i.reserved;
+  return n;
+}
+
+void MemoryReport::print(std::ostream &os) const {
+  auto row = [&](const std::string &label, size_t used, size_t reserved) {
+    os << "  " << std::left << std::setw(28) << label << std::right
+       << std::setw(10) << formatBytes(used) << std::setw(11)
+       << formatBytes(reserved) << std::setw(11)
+       << formatBytes(reserved - used) << "\n";
+  };
+
+  os << "  " << std::left << std::setw(28) << "Memory" << std::right
+     << std::setw(10) << "used" << std::setw(11) << "reserved"
+     << std::setw(11) << "slack" << "\n";
+  // Subsystems in order of first appearance
+  std::vector<std::string> subsystems;
+  for (const auto &i : m_items)
+    if (std::find(subsystems.begin(), subsystems.end(), i.subsystem) ==
+        subsystems.end())
+      subsystems.push_back(i.subsystem);
+  for (const auto &sub : subsystems) {
+    size_t used = 0, reserved = 0;
+    for (const auto &i : m_items)
+      if (i.subsystem == sub && !i.detail) {
+        used += i.used;
+        reserved += i.reserved;
+      }
+    row(sub, used, reserved);
+    for (const auto &i : m_items)
+      if (i.subsystem == sub)
+        row((i.detail ? "    " : "  ") + i.name, i.used, i.reserved);
+  }
+  row("total", used(), reserved());
+
+  const size_t rss = residentBytes(), peak = peakResidentBytes();
+  if (rss > 0)
+    os << "  Process resident: " << formatBytes(rss) << " (peak "
+       << formatBytes(peak) << ")\n";
+}
+
+size_t residentBytes() { return procStatusBytes("VmRSS"); }
+
+size_t peakResidentBytes() { return procStatusBytes("VmHWM"); }
+
+void addMesh(MemoryReport &report, const Mesh &mesh) {
+  report.addVector("mesh", "vertices", mesh.vertices);
+  report.addVector("mesh", "edges", mesh.edges);
+  size_t names = 0;
+  for (const auto &o : mesh.objects)
+    if (o.name.capacity() > std::string().capacity())
+      names += o.name.capacity() + 1;
+  report.add("mesh", "objects",
+             mesh.objects.size() * sizeof(MeshObject) + names,
+             mesh.objects.capacity() * sizeof(MeshObject) + names);
+  report.addVector("derived", "edge kinds", mesh.edgeKinds);
+  report.addVector("derived", "feature edges", mesh.featureEdges);
+}
+
+void addArena(MemoryReport &report, const FrameArena &arena,
+              const std::string &name) {
+  report.add("scratch", name, arena.bytesUsed(), arena.bytesReserved());
+}
+
+void addRenderLines(MemoryReport &report, const RenderStats &stats) {
+  report.add("scratch", "projected lines",
+             size_t(stats.emitted) * sizeof(ScreenLine),
+             size_t(stats.processed) * sizeof(ScreenLine), true);
+}
+
+void addFramebuffer(MemoryReport &report, const Framebuffer &fb,
+                    const std::string &name) {
+  report.add("framebuffer", name, size_t(fb.w) * size_t(fb.h) * 3,
+             fb.data.capacity());
+}
+
+void addInstances(MemoryReport &report, const InstanceSet &set) {
+  report.add("instances", "transforms, spheres, BVH", set.bytesUsed(),
+             set.bytesReserved());
+}
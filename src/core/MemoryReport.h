@@ -0,0 +1,68 @@
+#pragma once
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Mesh.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class InstanceSet;
+
+// Bytes held by one part of a subsystem. `used` is what the data needs,
+// `reserved` what is allocated for it; the difference is slack.
+struct MemoryItem {
+  std::string subsystem; // e.g. "mesh", "derived", "scratch"
+  std::string name;
+  size_t used = 0, reserved = 0;
+  // Breakdown of memory already counted by another item (e.g. the line
+  // buffer inside the frame arena): printed, but left out of the totals
+  bool detail = false;
+};
+
+// Memory broken down by subsystem, for sizing render containers. Items are
+// listed in the order they were added, grouped by subsystem.
+class MemoryReport {
+public:
+  void add(std::string subsystem, std::string name, size_t used,
+           size_t reserved, bool detail = false);
+  // size() vs capacity() of a vector-like container
+  template <typename V>
+  void addVector(std::string subsystem, std::string name, const V &v) {
+    using T = typename V::value_type;
+    add(std::move(subsystem), std::move(name), v.size() * sizeof(T),
+        v.capacity() * sizeof(T));
+  }
+
+  const std::vector<MemoryItem> &items() const { return m_items; }
+  size_t used() const;
+  size_t reserved() const;
+  size_t reserved(const std::string &subsystem) const;
+
+  // Table per subsystem with totals, followed by the process' resident set
+  void print(std::ostream &os) const;
+
+private:
+  std::vector<MemoryItem> m_items;
+};
+
+// Process resident set and its peak (VmRSS / VmHWM); 0 where unknown.
+size_t residentBytes();
+size_t peakResidentBytes();
+
+// Vertices, edges and objects under "mesh"; edge kinds and feature edges
+// under "derived".
+void addMesh(MemoryReport &report, const Mesh &mesh);
+// Sub-arena blocks of the arena under "scratch".
+void addArena(MemoryReport &report, const FrameArena &arena,
+              const std::string &name = "frame arena");
+// The projected-line buffer of one render, as a detail of its arena: it is
+// sized for every edge that reached projection, so culled and rejected edges
+// show up as slack.
+void addRenderLines(MemoryReport &report, const RenderStats &stats);
+void addFramebuffer(MemoryReport &report, const Framebuffer &fb,
+                    const std::string &name = "framebuffer");
+// Transforms, bounding spheres and BVH of an instance set under "instances"
+// (the shared mesh is not included).
+void addInstances(MemoryReport &report, const InstanceSet &set);
@@ -1,10 +1,62 @@
 #pragma once
+#include "Geometry.h"
+#include "HugePages.h"
 #include "Math.h"
 #include <cstdint>
+#include <string>
 #include <utility>
 #include <vector>
 
+// One `o` group of an OBJ file. Edges of an object are contiguous in
+// Mesh::edges; vertices referenced by them lie in [firstVertex, endVertex).
+struct MeshObject {
+  std::string name;
+  int firstEdge = 0;
+  int edgeCount = 0;
+  int firstVertex = 0;
+  int endVertex = 0;
+  Bounds bounds;
+};
+
+// How the faces around an edge meet (see classifyEdges in FeatureEdges.h).
+// Everything but Smooth is a feature edge.
+enum class EdgeKind : uint8_t { Smooth, Crease, Boundary, NonManifold };
+
 struct Mesh {
-  std::vector<Vec3f> vertices;            // positions
-  std::vector<std::pair<int, int>> edges; // pairs of vertex indices (0-based)
+  LargeVector<Vec3f> vertices;            // positions
+  LargeVector<std::pair<int, int>> edges; // pairs of vertex indices (0-based)
+  std::vector<MeshObject> objects; // `o` groups, else connected components
+  // Kind of each edge and the indices of the feature edges in ascending
+  // order; both empty unless the edges were classified at load time.
+  LargeVector<EdgeKind> edgeKinds;
+  LargeVector<uint32_t> featureEdges;
+
+  bool classified() const { return !edges.empty() && !edgeKinds.empty(); }
+};
+
+// Non-owning view of the geometry the renderer reads. A Mesh converts to it
+// implicitly; embedders can point it at arrays they own instead of copying
+// them into a Mesh.
+struct MeshView {
+  const Vec3f *vertices = nullptr;
+  size_t vertexCount = 0;
+  const std::pair<int, int> *edges = nullptr;
+  size_t edgeCount = 0;
+  // Feature edge indices and per-edge kinds; only meaningful when
+  // `classified` (edgeKinds may still be null)
+  const uint32_t *featureEdges = nullptr;
+  const EdgeKind *edgeKinds = nullptr;
+  size_t featureCount = 0;
+  bool classified = false;
+  // Objects (or components) the renderer can cull and hide as units
+  const MeshObject *objects = nullptr;
+  size_t objectCount = 0;
+
+  MeshView() = default;
+  MeshView(const Mesh &m)
+      : vertices(m.vertices.data()), vertexCount(m.vertices.size()),
+        edges(m.edges.data()), edgeCount(m.edges.size()),
+        featureEdges(m.featureEdges.data()), edgeKinds(m.edgeKinds.data()),
+        featureCount(m.featureEdges.size()), classified(m.classified()),
+        objects(m.objects.data()), objectCount(m.objects.size()) {}
 };
@@ -0,0 +1,253 @@
+#include "MeshSegment.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char kMagic[8] = {'r', '3', 'd', 'm', 'e', 's', 'h', '1'};
+
+// Start of a mesh segment; the arrays follow at 64-byte aligned offsets
+struct Header {
+  char magic[8];
+  uint64_t vertexCount, edgeCount, featureCount, kindCount, objectCount;
+  uint64_t vertices, edges, features, kinds, objects; // byte offsets
+};
+
+// MeshObject without its name
+struct ObjectRecord {
+  int firstEdge, edgeCount, firstVertex, endVertex;
+  Bounds bounds;
+};
+
+size_t align64(size_t n) { return (n + 63) & ~size_t(63); }
+} // namespace
+
+std::unique_ptr<SharedRegion> SharedRegion::create(const std::string &name,
+                                                   size_t bytes) {
+#ifdef __unix__
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    std::cerr << "Failed to create shared memory " << name << ": "
+              << std::strerror(errno) << "\n";
+    return nullptr;
+  }
+  void *p = MAP_FAILED;
+  if (ftruncate(fd, off_t(bytes)) == 0)
+    p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int err = errno;
+  close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    std::cerr << "Failed to map " << (bytes >> 20) << " MB of shared memory "
+              << name << ": " << std::strerror(err) << "\n";
+    return nullptr;
+  }
+  return std::unique_ptr<SharedRegion>(
+      new SharedRegion(name, static_cast<uint8_t *>(p), bytes, true));
+#else
+  std::cerr << "Shared memory is not supported on this platform\n";
+  (void)name;
+  (void)bytes;
+  return nullptr;
+#endif
+}
+
+std::unique_ptr<SharedRegion> SharedRegion::open(const std::string &name) {
+#ifdef __unix__
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    std::cerr << "Failed to open shared memory " << name << ": "
+              << std::strerror(errno) << "\n";
+    return nullptr;
+  }
+  struct stat st;
+  void *p = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    p = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED,
+             fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    std::cerr << "Failed to map shared memory " << name << "\n";
+    return nullptr;
+  }
+  return std::unique_ptr<SharedRegion>(new SharedRegion(
+      name, static_cast<uint8_t *>(p), size_t(st.st_size), false));
+#else
+  std::cerr << "Shared memory is not supported on this platform\n";
+  (void)name;
+  return nullptr;
+#endif
+}
+
+SharedRegion::~SharedRegion() {
+#ifdef __unix__
+  munmap(m_data, m_size);
+  if (m_owner)
+    shm_unlink(m_name.c_str());
+#endif
+}
+
+std::unique_ptr<MeshSegment> MeshSegment::create(const std::string &name,
+                                                 const Mesh &mesh) {
+  // Object table: real objects, split into parts of at most kPartEdges
+  struct Part {
+    size_t object, begin, end;
+  };
+  const bool whole = mesh.objects.empty();
+  std::vector<MeshObject> single;
+  if (whole) {
+    single.resize(1);
+    single[0].edgeCount = int(mesh.edges.size());
+    single[0].endVertex = int(mesh.vertices.size());
+  }
+  const std::vector<MeshObject> &objects = whole ? single : mesh.objects;
+  std::vector<Part> parts;
+  for (size_t k = 0; k < objects.size(); ++k) {
+    const size_t begin = size_t(objects[k].firstEdge);
+    const size_t end = begin + size_t(objects[k].edgeCount);
+    for (size_t b = begin; b < end; b += kPartEdges)
+      parts.push_back({k, b, std::min(end, b + kPartEdges)});
+  }
+
+  Header h;
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.vertexCount = mesh.vertices.size();
+  h.edgeCount = mesh.edges.size();
+  h.featureCount = mesh.featureEdges.size();
+  h.kindCount = mesh.edgeKinds.size();
+  h.objectCount = parts.size();
+  h.vertices = align64(sizeof(Header));
+  h.edges = align64(h.vertices + h.vertexCount * sizeof(Vec3f));
+  h.features = align64(h.edges + h.edgeCount * sizeof(std::pair<int, int>));
+  h.kinds = align64(h.features + h.featureCount * sizeof(uint32_t));
+  h.objects = align64(h.kinds + h.kindCount * sizeof(EdgeKind));
+  const size_t bytes = h.objects + parts.size() * sizeof(ObjectRecord);
+
+  std::unique_ptr<SharedRegion> region = SharedRegion::create(name, bytes);
+  if (!region)
+    return nullptr;
+  uint8_t *base = region->data();
+  std::memcpy(base, &h, sizeof(h));
+  std::memcpy(base + h.vertices, mesh.vertices.data(),
+              h.vertexCount * sizeof(Vec3f));
+  std::memcpy(base + h.edges, mesh.edges.data(),
+              h.edgeCount * sizeof(std::pair<int, int>));
+  std::memcpy(base + h.features, mesh.featureEdges.data(),
+              h.featureCount * sizeof(uint32_t));
+  std::memcpy(base + h.kinds, mesh.edgeKinds.data(),
+              h.kindCount * sizeof(EdgeKind));
+
+  // Parts of split objects need bounds of their own
+  ObjectRecord *records = reinterpret_cast<ObjectRecord *>(base + h.objects);
+  parallelFor(0, parts.size(), 16, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i) {
+      const Part &p = parts[i];
+      const MeshObject &o = objects[p.object];
+      ObjectRecord r{int(p.begin), int(p.end - p.begin), o.firstVertex,
+                     o.endVertex, o.bounds};
+      if (whole || size_t(o.edgeCount) > kPartEdges) {
+        r.bounds = Bounds{};
+        for (size_t e = p.begin; e < p.end; ++e) {
+          r.bounds.expand(mesh.vertices[size_t(mesh.edges[e].first)]);
+          r.bounds.expand(mesh.vertices[size_t(mesh.edges[e].second)]);
+        }
+      }
+      std::memcpy(records + i, &r, sizeof(r));
+    }
+  });
+
+  std::unique_ptr<MeshSegment> seg(new MeshSegment(std::move(region)));
+  if (!seg->attach())
+    return nullptr;
+  return seg;
+}
+
+std::unique_ptr<MeshSegment> MeshSegment::open(const std::string &name) {
+  std::unique_ptr<SharedRegion> region = SharedRegion::open(name);
+  if (!region)
+    return nullptr;
+  std::unique_ptr<MeshSegment> seg(new MeshSegment(std::move(region)));
+  if (!seg->attach()) {
+    std::cerr << "Not a mesh segment: " << name << "\n";
+    return nullptr;
+  }
+  return seg;
+}
+
+bool MeshSegment::attach() {
+  const uint8_t *base = m_region->data();
+  const size_t size = m_region->size();
+  Header h;
+  if (size < sizeof(h))
+    return false;
+  std::memcpy(&h, base, sizeof(h));
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+      h.objects + h.objectCount * sizeof(ObjectRecord) > size)
+    return false;
+
+  m_objects.resize(h.objectCount);
+  for (size_t i = 0; i < h.objectCount; ++i) {
+    ObjectRecord r;
+    std::memcpy(&r, base + h.objects + i * sizeof(r), sizeof(r));
+    m_objects[i].firstEdge = r.firstEdge;
+    m_objects[i].edgeCount = r.edgeCount;
+    m_objects[i].firstVertex = r.firstVertex;
+    m_objects[i].endVertex = r.endVertex;
+    m_objects[i].bounds = r.bounds;
+  }
+
+  MeshView &v = m_view;
+  v.vertices = reinterpret_cast<const Vec3f *>(base + h.vertices);
+  v.vertexCount = h.vertexCount;
+  v.edges = reinterpret_cast<const std::pair<int, int> *>(base + h.edges);
+  v.edgeCount = h.edgeCount;
+  v.featureEdges = reinterpret_cast<const uint32_t *>(base + h.features);
+  v.featureCount = h.featureCount;
+  v.edgeKinds = reinterpret_cast<const EdgeKind *>(base + h.kinds);
+  v.classified = h.edgeCount > 0 && h.kindCount > 0;
+  v.objects = m_objects.data();
+  v.objectCount = m_objects.size();
+  return true;
+}
+
+MeshView meshShard(const MeshView &mesh, size_t k, size_t n) {
+  MeshView shard = mesh;
+  if (mesh.objectCount == 0) {
+    if (k != 0) {
+      shard.edgeCount = 0;
+      shard.featureCount = 0;
+    }
+    return shard;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < mesh.objectCount; ++i)
+    total += size_t(mesh.objects[i].edgeCount);
+  // Shard j starts at the first object with j/n of the edges before it
+  auto start = [&](size_t j) {
+    if (j >= n)
+      return mesh.objectCount;
+    const size_t target = total * j / n;
+    size_t i = 0, before = 0;
+    while (i < mesh.objectCount && before < target)
+      before += size_t(mesh.objects[i++].edgeCount);
+    return i;
+  };
+  const size_t begin = start(k), end = start(k + 1);
+  shard.objects = mesh.objects + begin;
+  shard.objectCount = end - begin;
+  if (shard.objectCount == 0) {
+    // Without objects the renderer would draw every edge
+    shard.edgeCount = 0;
+    shard.featureCount = 0;
+  }
+  return shard;
+}
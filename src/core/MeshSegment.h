@@ -0,0 +1,68 @@
+#pragma once
+#include "Mesh.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Named POSIX shared memory (shm_open), mapped read-write. The process that
+// creates a region owns the name and unlinks it when the region is
+// destroyed; other processes open it by name while it exists. Failures are
+// reported on stderr and return null.
+class SharedRegion {
+public:
+  static std::unique_ptr<SharedRegion> create(const std::string &name,
+                                              size_t bytes);
+  static std::unique_ptr<SharedRegion> open(const std::string &name);
+  ~SharedRegion();
+  SharedRegion(const SharedRegion &) = delete;
+  SharedRegion &operator=(const SharedRegion &) = delete;
+
+  uint8_t *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  const std::string &name() const { return m_name; }
+
+private:
+  SharedRegion(std::string name, uint8_t *data, size_t size, bool owner)
+      : m_name(std::move(name)), m_data(data), m_size(size), m_owner(owner) {}
+
+  std::string m_name;
+  uint8_t *m_data;
+  size_t m_size;
+  bool m_owner;
+};
+
+// A mesh's geometry packed into one SharedRegion, so render processes map a
+// single copy instead of loading their own. Holds vertices, edges, feature
+// edges, edge kinds and the object table; object names are not kept, and
+// objects larger than kPartEdges edges (or the whole mesh, if it has none)
+// are stored as several parts with their own bounds, so meshShard() can
+// balance work across processes.
+class MeshSegment {
+public:
+  static constexpr size_t kPartEdges = size_t(1) << 16;
+
+  static std::unique_ptr<MeshSegment> create(const std::string &name,
+                                             const Mesh &mesh);
+  static std::unique_ptr<MeshSegment> open(const std::string &name);
+
+  // Points into the shared pages (and this segment's object table)
+  MeshView view() const { return m_view; }
+  size_t bytes() const { return m_region->size(); }
+  const std::string &name() const { return m_region->name(); }
+
+private:
+  explicit MeshSegment(std::unique_ptr<SharedRegion> region)
+      : m_region(std::move(region)) {}
+  bool attach();
+
+  std::unique_ptr<SharedRegion> m_region;
+  std::vector<MeshObject> m_objects; // rebuilt from the shared records
+  MeshView m_view;
+};
+
+// Shard k of n: a contiguous run of the mesh's objects holding about
+// 1/n of its edges. Together the shards cover every object exactly once; a
+// mesh without objects goes to shard 0 whole.
+MeshView meshShard(const MeshView &mesh, size_t k, size_t n);
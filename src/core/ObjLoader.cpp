@@ -1,68 +1,573 @@
 #include "ObjLoader.h"
+#include "Components.h"
+#include "FeatureEdges.h"
 #include "Geometry.h"
-#include <cctype>
-#include <cstdlib>
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <cerrno>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
-static void addFaceEdges(const std::vector<int> &f,
-                         std::vector<std::pair<int, int>> &edges) {
-  const int n = (int)f.size();
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __unix__
+#include <sys/stat.h>
+#endif
+
+// Loading runs as a task graph over chunks of the file:
+//
+//   read[k] (calling thread) -> parse[k] -> merge[k] -> ... -> assemble
+//                                             ^
+//                                  merge[k-1]-'
+//
+// parse[k] turns a chunk of whole lines into vertices and face edges and
+// drops duplicates within the chunk; merge[k] runs in file order, rebasing
+// relative indices and deduplicating against everything merged before, so
+// the result matches a sequential load. Reading, parsing and merging of
+// different chunks overlap; assemble copies vertices into place, builds
+// per-object bounds and classifies edges from the kept faces in parallel;
+// files without objects are then split into connected components.
+
+namespace {
+
+// Chunks end on a line boundary and grow from 64 KB so small files and the
+// first parse start early.
+constexpr size_t kFirstChunkBytes = size_t(64) << 10;
+constexpr size_t kMaxChunkBytes = size_t(4) << 20;
+
+struct ObjChunk {
+  std::string text; // released once parsed
+  std::vector<Vec3f> vertices;
+  std::vector<std::pair<int, int>> edges;
+  // Endpoint slots (edge * 2 + end) from negative OBJ indices; these are
+  // relative to the chunk's first vertex until merged.
+  std::vector<uint32_t> relative;
+  std::vector<std::pair<std::string, size_t>> objects; // name, first edge
+  // Faces for edge classification, if kept: vertex indices back to back,
+  // and slots of faceIndices that hold relative indices
+  bool keepFaces = false;
+  std::vector<int> faceIndices;
+  std::vector<uint32_t> faceSizes;
+  std::vector<uint32_t> faceRelative;
+  size_t vertexBase = 0;
+  size_t bytes = 0;
+  size_t faces = 0;
+};
+
+struct IngestState {
+  const LoadOptions *opt = nullptr;
+  LoadProgress progress;
+  std::deque<ObjChunk> chunks; // deque: parse nodes hold stable pointers
+  size_t vertexCount = 0;
+  EdgeKeySet seen;
+  LargeVector<std::pair<int, int>> edges;
+  std::vector<MeshObject> objects;
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Locale-independent; the Qt app switches the C locale to the user's.
+const char *parseFloat(const char *p, const char *end, float &out) {
+  static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *s = p;
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+  uint64_t mant = 0;
+  int digits = 0, exp10 = 0;
+  bool any = false;
+  for (; p < end && isDigit(*p); ++p, any = true) {
+    if (digits < 19) {
+      mant = mant * 10 + uint64_t(*p - '0');
+      digits += mant != 0;
+    } else {
+      ++exp10;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && isDigit(*p); ++p, any = true) {
+      if (digits < 19) {
+        mant = mant * 10 + uint64_t(*p - '0');
+        digits += mant != 0;
+        --exp10;
+      }
+    }
+  }
+  if (!any)
+    return s;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool eneg = false;
+    if (q < end && (*q == '-' || *q == '+'))
+      eneg = *q++ == '-';
+    if (q < end && isDigit(*q)) {
+      int e = 0;
+      for (; q < end && isDigit(*q); ++q)
+        e = std::min(e * 10 + (*q - '0'), 9999);
+      exp10 += eneg ? -e : e;
+      p = q;
+    }
+  }
+  double v = double(mant);
+  if (exp10 < 0 && exp10 >= -22)
+    v /= kPow10[-exp10];
+  else if (exp10 > 0 && exp10 <= 22)
+    v *= kPow10[exp10];
+  else if (exp10 != 0)
+    v *= std::pow(10.0, exp10);
+  out = float(neg ? -v : v);
+  return p;
+}
+
+const char *parseInt(const char *p, const char *end, int &out) {
+  const char *s = p;
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+  if (p == end || !isDigit(*p))
+    return s;
+  int64_t v = 0;
+  for (; p < end && isDigit(*p); ++p)
+    v = std::min<int64_t>(v * 10 + (*p - '0'), std::numeric_limits<int>::max());
+  out = int(neg ? -v : v);
+  return p;
+}
+
+void addFaceEdges(const std::vector<int> &f, const std::vector<uint8_t> &rel,
+                  ObjChunk &c) {
+  const size_t n = f.size();
   if (n < 2)
     return;
-  for (int i = 0; i < n; ++i) {
-    int a = f[i];
-    int b = f[(i + 1) % n];
-    if (a == b)
+  for (size_t i = 0; i < n; ++i) {
+    const size_t j = (i + 1) % n;
+    if (f[i] == f[j] && rel[i] == rel[j])
       continue;
-    edges.emplace_back(a, b);
+    if (rel[i])
+      c.relative.push_back(uint32_t(c.edges.size() * 2));
+    if (rel[j])
+      c.relative.push_back(uint32_t(c.edges.size() * 2 + 1));
+    c.edges.emplace_back(f[i], f[j]);
   }
 }
 
-bool loadOBJ(const std::string &path, Mesh &out) {
-  std::ifstream in(path);
-  if (!in) {
-    std::cerr << "Failed to open OBJ: " << path << "\n";
-    return false;
+// Drops edges already seen earlier in the same chunk, keeping object starts
+// pointing at the right place. Chunks with relative indices are left to the
+// merge stage, which sees their final indices.
+void dedupChunk(ObjChunk &c) {
+  if (!c.relative.empty() || c.edges.empty())
+    return;
+  R3D_PROBE2(dedup_start, 0, c.edges.size());
+  EdgeKeySet seen(c.edges.size() / 2);
+  size_t w = 0, obj = 0;
+  for (size_t i = 0; i < c.edges.size(); ++i) {
+    for (; obj < c.objects.size() && c.objects[obj].second == i; ++obj)
+      c.objects[obj].second = w;
+    const auto &e = c.edges[i];
+    if (seen.insert(edgeKey(e.first, e.second)))
+      c.edges[w++] = e;
   }
-  std::string line;
-  std::vector<std::pair<int, int>> edges;
-  while (std::getline(in, line)) {
-    if (line.empty() || line[0] == '#')
+  for (; obj < c.objects.size(); ++obj)
+    c.objects[obj].second = w;
+  c.edges.resize(w);
+  c.edges.shrink_to_fit();
+  R3D_PROBE2(dedup_end, 0, w);
+}
+
+void parseChunk(ObjChunk &c) {
+  const char *p = c.text.data();
+  const char *end = p + c.text.size();
+  std::vector<int> face;
+  std::vector<uint8_t> faceRel;
+  while (p < end) {
+    const char *eol =
+        static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+    if (!eol)
+      eol = end;
+    const char *q = p;
+    while (q < eol && isSpace(*q))
+      ++q;
+    const char *tag = q;
+    while (q < eol && !isSpace(*q))
+      ++q;
+    const size_t tagLen = size_t(q - tag);
+
+    if (tagLen == 1 && tag[0] == 'v') {
+      float xyz[3] = {0.f, 0.f, 0.f};
+      for (float &f : xyz) {
+        while (q < eol && isSpace(*q))
+          ++q;
+        const char *next = parseFloat(q, eol, f);
+        if (next == q)
+          break;
+        q = next;
+      }
+      c.vertices.push_back({xyz[0], xyz[1], xyz[2]});
+    } else if (tagLen == 1 && tag[0] == 'f') {
+      face.clear();
+      faceRel.clear();
+      // tokens like "3", or "3/2/1", or "3//1" or "3/"
+      for (;;) {
+        while (q < eol && isSpace(*q))
+          ++q;
+        if (q == eol)
+          break;
+        int idx = 0;
+        q = parseInt(q, eol, idx);
+        while (q < eol && !isSpace(*q))
+          ++q;
+        if (idx > 0) {
+          face.push_back(idx - 1); // 0-based
+          faceRel.push_back(0);
+        } else if (idx < 0) {
+          face.push_back(int(c.vertices.size()) + idx);
+          faceRel.push_back(1);
+        }
+      }
+      addFaceEdges(face, faceRel, c);
+      if (c.keepFaces && face.size() >= 2) {
+        for (size_t i = 0; i < face.size(); ++i)
+          if (faceRel[i])
+            c.faceRelative.push_back(uint32_t(c.faceIndices.size() + i));
+        c.faceIndices.insert(c.faceIndices.end(), face.begin(), face.end());
+        c.faceSizes.push_back(uint32_t(face.size()));
+      }
+      ++c.faces;
+    } else if (tagLen == 1 && tag[0] == 'o') {
+      while (q < eol && isSpace(*q))
+        ++q;
+      const char *nameEnd = eol;
+      while (nameEnd > q && isSpace(nameEnd[-1]))
+        --nameEnd;
+      c.objects.emplace_back(std::string(q, nameEnd), c.edges.size());
+    }
+    p = eol + 1;
+  }
+  std::string().swap(c.text);
+  dedupChunk(c);
+}
+
+void mergeChunk(IngestState &st, ObjChunk &c) {
+  c.vertexBase = st.vertexCount;
+  st.vertexCount += c.vertices.size();
+  for (uint32_t slot : c.relative) {
+    auto &e = c.edges[slot / 2];
+    (slot & 1 ? e.second : e.first) += int(c.vertexBase);
+  }
+  for (uint32_t slot : c.faceRelative)
+    c.faceIndices[slot] += int(c.vertexBase);
+  std::vector<uint32_t>().swap(c.faceRelative);
+
+  size_t obj = 0;
+  auto openObjects = [&](size_t upTo) {
+    for (; obj < c.objects.size() && c.objects[obj].second <= upTo; ++obj) {
+      MeshObject o;
+      o.name = std::move(c.objects[obj].first);
+      o.firstEdge = int(st.edges.size());
+      st.objects.push_back(std::move(o));
+    }
+  };
+  const size_t edgesBefore = st.edges.size();
+  R3D_PROBE2(dedup_start, 1, c.edges.size());
+  for (size_t i = 0; i < c.edges.size(); ++i) {
+    openObjects(i);
+    const auto &e = c.edges[i];
+    if (e.first == e.second)
       continue;
-    std::istringstream iss(line);
-    std::string tag;
-    iss >> tag;
-    if (tag == "v") {
-      Vec3f v{};
-      iss >> v.x >> v.y >> v.z;
-      out.vertices.push_back(v);
-    } else if (tag == "f") {
-      std::vector<int> f;
-      std::string tok;
-      while (iss >> tok) {
-        // token like "3", or "3/2/1", or "3//1" or "3/"
-        std::istringstream tss(tok);
-        std::string a;
-        std::getline(tss, a, '/');
-        if (a.empty())
+    if (st.seen.insert(edgeKey(e.first, e.second)))
+      st.edges.push_back(e);
+  }
+  openObjects(std::numeric_limits<size_t>::max());
+  R3D_PROBE2(dedup_end, 1, st.edges.size() - edgesBefore);
+  std::vector<std::pair<int, int>>().swap(c.edges);
+  std::vector<uint32_t>().swap(c.relative);
+
+  st.progress.bytesRead += c.bytes;
+  st.progress.vertices += c.vertices.size();
+  st.progress.faces += c.faces;
+  if (st.opt->onProgress)
+    st.opt->onProgress(st.progress);
+}
+
+bool cancelled(const LoadOptions &opt) {
+  return opt.cancel && opt.cancel->load(std::memory_order_relaxed);
+}
+
+void assemble(IngestState &st, Mesh &mesh) {
+  mesh.vertices.resize(st.vertexCount);
+  parallelFor(0, st.chunks.size(), 1, [&](size_t lo, size_t hi) {
+    for (size_t k = lo; k < hi; ++k) {
+      ObjChunk &c = st.chunks[k];
+      std::copy(c.vertices.begin(), c.vertices.end(),
+                mesh.vertices.begin() + std::ptrdiff_t(c.vertexBase));
+      std::vector<Vec3f>().swap(c.vertices);
+    }
+  });
+  mesh.edges = std::move(st.edges);
+
+  // faces before the first `o` line go into an unnamed object
+  auto &objects = st.objects;
+  if (!objects.empty() && objects.front().firstEdge > 0)
+    objects.insert(objects.begin(), MeshObject{});
+  for (size_t i = 0; i < objects.size(); ++i) {
+    int end = (i + 1 < objects.size()) ? objects[i + 1].firstEdge
+                                       : (int)mesh.edges.size();
+    objects[i].edgeCount = end - objects[i].firstEdge;
+  }
+  // Drop objects left without edges and compute their extents
+  objects.erase(std::remove_if(objects.begin(), objects.end(),
+                               [](const MeshObject &o) {
+                                 return o.edgeCount == 0;
+                               }),
+                objects.end());
+  const int nv = (int)mesh.vertices.size();
+  parallelFor(0, objects.size(), 1, [&](size_t lo, size_t hi) {
+    for (size_t k = lo; k < hi; ++k) {
+      MeshObject &obj = objects[k];
+      obj.firstVertex = std::numeric_limits<int>::max();
+      obj.endVertex = 0;
+      for (int i = obj.firstEdge; i < obj.firstEdge + obj.edgeCount; ++i) {
+        for (int idx : {mesh.edges[i].first, mesh.edges[i].second}) {
+          if (idx < 0 || idx >= nv)
+            continue;
+          obj.firstVertex = std::min(obj.firstVertex, idx);
+          obj.endVertex = std::max(obj.endVertex, idx + 1);
+          obj.bounds.expand(mesh.vertices[idx]);
+        }
+      }
+      obj.firstVertex = std::min(obj.firstVertex, obj.endVertex);
+    }
+  });
+  mesh.objects = std::move(objects);
+
+  if (st.opt->findFeatureEdges) {
+    // Gather the chunks' faces, then classify and drop them
+    FaceList faces;
+    std::vector<size_t> indexBase(st.chunks.size() + 1, 0);
+    std::vector<size_t> faceBase(st.chunks.size() + 1, 0);
+    for (size_t k = 0; k < st.chunks.size(); ++k) {
+      indexBase[k + 1] = indexBase[k] + st.chunks[k].faceIndices.size();
+      faceBase[k + 1] = faceBase[k] + st.chunks[k].faceSizes.size();
+    }
+    faces.indices.resize(indexBase.back());
+    faces.starts.resize(faceBase.back() + 1);
+    faces.starts[faceBase.back()] = indexBase.back();
+    parallelFor(0, st.chunks.size(), 1, [&](size_t lo, size_t hi) {
+      for (size_t k = lo; k < hi; ++k) {
+        ObjChunk &c = st.chunks[k];
+        std::copy(c.faceIndices.begin(), c.faceIndices.end(),
+                  faces.indices.begin() + std::ptrdiff_t(indexBase[k]));
+        size_t at = indexBase[k];
+        for (size_t f = 0; f < c.faceSizes.size(); ++f) {
+          faces.starts[faceBase[k] + f] = at;
+          at += c.faceSizes[f];
+        }
+        std::vector<int>().swap(c.faceIndices);
+        std::vector<uint32_t>().swap(c.faceSizes);
+      }
+    });
+    classifyEdges(mesh, faces, st.opt->creaseAngleDeg);
+  }
+  if (st.opt->splitComponents)
+    splitComponents(mesh);
+}
+
+// Fills `buf` with up to `size` bytes, less only at the end of the input;
+// throws on read errors
+using ReadFn = std::function<size_t(char *buf, size_t size)>;
+
+// A chunk held in memory until its parse node is done with it
+struct PendingToken {
+  std::atomic<int> *pending;
+  ~PendingToken() { --*pending; }
+};
+
+// The loader proper: reads chunks on the calling thread while earlier ones
+// are parsed and merged on the pool. At most a few chunks are held unparsed,
+// so input of any length streams through in bounded memory.
+bool loadStream(const std::string &name, const ReadFn &read,
+                uint64_t totalBytes, Mesh &out, const LoadOptions &opt) {
+  IngestState st;
+  st.opt = &opt;
+  st.progress.totalBytes = totalBytes;
+  R3D_PROBE2(load_start, name.c_str(), st.progress.totalBytes);
+  Mesh mesh;
+  ThreadPool &pool = ThreadPool::shared();
+  // Unparsed chunks held in memory before the reader waits for the parsers
+  const int maxPending = int(pool.size() + 1) * 2;
+  std::atomic<int> pending{0};
+  try {
+    TaskGraph graph(pool);
+    TaskGraph::NodeId lastMerge = 0;
+    bool haveMerge = false;
+    std::string carry;
+    size_t chunkBytes = kFirstChunkBytes;
+    // After a failed node later ones are skipped; stop reading and let
+    // wait() rethrow its exception
+    for (bool eof = false; !eof && !cancelled(opt) && !graph.failed();) {
+      while (pending.load() >= maxPending && !graph.failed()) {
+        if (!graph.runOne())
+          std::this_thread::yield();
+      }
+      std::string text = std::move(carry);
+      carry.clear();
+      const size_t old = text.size();
+      text.resize(old + chunkBytes);
+      const size_t got = read(&text[old], chunkBytes);
+      text.resize(old + got);
+      eof = got < chunkBytes;
+      chunkBytes = std::min(chunkBytes * 2, kMaxChunkBytes);
+      if (!eof) {
+        // Hand over whole lines only; the tail starts the next chunk
+        const size_t nl = text.rfind('\n');
+        if (nl == std::string::npos) {
+          carry = std::move(text);
           continue;
-        int idx = std::stoi(a);
-        if (idx < 0)
-          idx = (int)out.vertices.size() + idx + 1;
-        f.push_back(idx - 1); // 0-based
+        }
+        carry.assign(text, nl + 1, std::string::npos);
+        text.resize(nl + 1);
       }
-      if (f.size() >= 2)
-        addFaceEdges(f, edges);
+      if (text.empty())
+        continue;
+
+      ObjChunk *chunk = &st.chunks.emplace_back();
+      chunk->keepFaces = opt.findFeatureEdges;
+      chunk->bytes = text.size();
+      chunk->text = std::move(text);
+      // The token counts the chunk off when the node's function is
+      // destroyed: after parsing, throwing, or being skipped unrun
+      ++pending;
+      std::shared_ptr<PendingToken> token(new PendingToken{&pending});
+      auto parse = graph.add([chunk, token, &opt] {
+        if (!cancelled(opt))
+          parseChunk(*chunk);
+      });
+      std::vector<TaskGraph::NodeId> deps{parse};
+      if (haveMerge)
+        deps.push_back(lastMerge);
+      lastMerge = graph.add(
+          [&st, chunk, &opt] {
+            if (!cancelled(opt))
+              mergeChunk(st, *chunk);
+          },
+          deps);
+      haveMerge = true;
     }
+    std::vector<TaskGraph::NodeId> deps;
+    if (haveMerge)
+      deps.push_back(lastMerge);
+    graph.add(
+        [&st, &mesh, &opt] {
+          if (!cancelled(opt))
+            assemble(st, mesh);
+        },
+        deps);
+    graph.wait();
+  } catch (const std::exception &e) {
+    std::cerr << "Failed to load OBJ " << name << ": " << e.what() << "\n";
+    R3D_PROBE4(load_end, name.c_str(), 0, 0, 0);
+    return false;
+  }
+
+  if (cancelled(opt)) {
+    std::cerr << "Cancelled loading \"" << name << "\"\n";
+    R3D_PROBE4(load_end, name.c_str(), 0, 0, 0);
+    return false;
   }
-  // Deduplicate edges
-  dedupEdges(edges);
-  out.edges = std::move(edges);
-  std::cerr << "Loaded \"" << path << "\" with " << out.vertices.size()
-            << " vertices, " << out.edges.size() << " unique edges.\n";
+  out = std::move(mesh);
+  R3D_PROBE4(load_end, name.c_str(), out.vertices.size(), out.edges.size(),
+             1);
+  std::cerr << "Loaded \"" << name << "\" with " << out.vertices.size()
+            << " vertices, " << out.edges.size() << " unique edges";
+  if (out.classified())
+    std::cerr << " (" << out.featureEdges.size() << " feature edges)";
+  std::cerr << ".\n";
   return true;
 }
+
+} // namespace
+
+bool loadOBJ(const std::string &path, Mesh &out) {
+  return loadOBJ(path, out, LoadOptions{});
+}
+
+bool loadOBJ(const std::string &path, Mesh &out, const LoadOptions &opt) {
+  if (path == "-")
+    return loadOBJ(0, "<stdin>", out, opt);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "Failed to open OBJ: " << path << "\n";
+    return false;
+  }
+  uint64_t totalBytes = 0;
+  if (in.seekg(0, std::ios::end)) {
+    totalBytes = uint64_t(std::streamoff(in.tellg()));
+    in.seekg(0, std::ios::beg);
+  }
+  in.clear();
+  return loadStream(
+      path,
+      [&in](char *buf, size_t size) {
+        in.read(buf, std::streamsize(size));
+        if (in.bad())
+          throw std::runtime_error("read failed");
+        return size_t(in.gcount());
+      },
+      totalBytes, out, opt);
+}
+
+bool loadOBJ(int fd, const std::string &name, Mesh &out,
+             const LoadOptions &opt) {
+  uint64_t totalBytes = 0;
+#ifdef __unix__
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    totalBytes = uint64_t(info.st_size);
+#endif
+  return loadStream(
+      name,
+      [fd](char *buf, size_t size) {
+        // Pipes return what the writer has produced so far: keep reading
+        // until the chunk is full or the writer closes its end
+        size_t got = 0;
+        while (got < size) {
+          const size_t want = std::min<size_t>(size - got, size_t(1) << 30);
+#ifdef _WIN32
+          const long n = long(_read(fd, buf + got, unsigned(want)));
+#else
+          const long n = long(::read(fd, buf + got, want));
+#endif
+          if (n == 0)
+            break;
+          if (n < 0) {
+            if (errno == EINTR)
+              continue;
+            throw std::runtime_error(std::strerror(errno));
+          }
+          got += size_t(n);
+        }
+        return got;
+      },
+      totalBytes, out, opt);
+}
@@ -1,5 +1,36 @@
 #pragma once
 #include "Mesh.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
 
+struct LoadProgress {
+  uint64_t bytesRead = 0;  // bytes parsed and merged so far
+  uint64_t totalBytes = 0; // file size, 0 if unknown
+  uint64_t vertices = 0;
+  uint64_t faces = 0;
+};
+
+struct LoadOptions {
+  // Called after each chunk is merged, in file order, on a loader thread.
+  std::function<void(const LoadProgress &)> onProgress;
+  // Polled between chunks; when set the load stops and returns false.
+  const std::atomic<bool> *cancel = nullptr;
+  // Classify edges by the faces around them (Mesh::edgeKinds, featureEdges);
+  // faces are kept only until then.
+  bool findFeatureEdges = true;
+  float creaseAngleDeg = 30.f;
+  // Files without `o` groups: one object per connected component, with
+  // vertices and edges reordered to match (see splitComponents).
+  bool splitComponents = true;
+};
+
+// A path of "-" reads standard input.
 bool loadOBJ(const std::string &path, Mesh &out);
+bool loadOBJ(const std::string &path, Mesh &out, const LoadOptions &opt);
+// Streams from a file descriptor, e.g. a pipe from a generator: parsing
+// overlaps with the writer, and only a few MB-sized chunks are buffered.
+// `name` is used in messages; the descriptor is not closed.
+bool loadOBJ(int fd, const std::string &name, Mesh &out,
+             const LoadOptions &opt = LoadOptions{});
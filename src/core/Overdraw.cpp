@@ -0,0 +1,104 @@
+#include "Overdraw.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+int bucketOf(uint32_t count) {
+  int b = 0;
+  while (b < OverdrawStats::kBuckets - 1 && (uint32_t(1) << b) < count)
+    ++b;
+  return b;
+}
+
+// Heatmap ramp, one stop per doubling of the count
+const uint8_t kRamp[7][3] = {
+    {30, 40, 150},  {30, 120, 220}, {40, 200, 200}, {80, 210, 70},
+    {240, 210, 40}, {240, 70, 30},  {255, 255, 255},
+};
+} // namespace
+
+void OverdrawMap::resize(int W, int H) {
+  w = std::max(W, 0);
+  h = std::max(H, 0);
+  counts.assign(size_t(w) * size_t(h), 0);
+}
+
+void OverdrawMap::clear() { std::fill(counts.begin(), counts.end(), 0); }
+
+void OverdrawMap::addLine(Vec2f a, Vec2f b) {
+  // Same rounding as the renderer's rasterizer
+  forEachLinePixel(int(std::lround(a.x)), int(std::lround(a.y)),
+                   int(std::lround(b.x)), int(std::lround(b.y)), w, h,
+                   [&](int x, int y) {
+                     ++counts[size_t(y) * size_t(w) + size_t(x)];
+                   });
+}
+
+void OverdrawMap::addLines(const ScreenLine *lines, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    addLine(lines[i].a, lines[i].b);
+}
+
+void OverdrawMap::addLines(const ScreenLines &lines) {
+  for (size_t i = 0; i < lines.size; ++i)
+    addLine({lines.ax[i], lines.ay[i]}, {lines.bx[i], lines.by[i]});
+}
+
+const char *OverdrawStats::bucketLabel(int bucket) {
+  static const char *const kLabels[kBuckets] = {
+      "1", "2", "3-4", "5-8", "9-16", "17-32", "33-64", "65+"};
+  return bucket >= 0 && bucket < kBuckets ? kLabels[bucket] : "?";
+}
+
+OverdrawStats overdrawStats(const OverdrawMap &map) {
+  OverdrawStats s;
+  for (uint32_t c : map.counts) {
+    if (c == 0)
+      continue;
+    s.writes += c;
+    ++s.covered;
+    s.maxCount = std::max(s.maxCount, c);
+    ++s.histogram[bucketOf(c)];
+  }
+  return s;
+}
+
+void overdrawColor(uint32_t count, uint8_t rgb[3]) {
+  const float t = std::min(std::log2(float(std::max(count, 1u))), 6.f);
+  const int i = std::min(int(t), 5);
+  const float f = t - float(i);
+  for (int k = 0; k < 3; ++k)
+    rgb[k] = uint8_t(float(kRamp[i][k]) +
+                     f * (float(kRamp[i + 1][k]) - float(kRamp[i][k])) + 0.5f);
+}
+
+void drawOverdrawHeatmap(const OverdrawMap &map, const PixelView &out) {
+  const int w = std::min(map.w, out.w), h = std::min(map.h, out.h);
+  for (int y = 0; y < h; ++y) {
+    const uint32_t *row = map.counts.data() + size_t(y) * size_t(map.w);
+    for (int x = 0; x < w; ++x) {
+      if (row[x] == 0)
+        continue;
+      uint8_t c[3];
+      overdrawColor(row[x], c);
+      out.put(x, y, c[0], c[1], c[2]);
+    }
+  }
+}
+
+void printOverdrawStats(std::ostream &os, const OverdrawStats &s) {
+  const std::ios::fmtflags flags = os.flags();
+  const std::streamsize precision = os.precision(1);
+  os.setf(std::ios::fixed, std::ios::floatfield);
+  os << "Overdraw: " << s.writes << " pixel writes to " << s.covered
+     << " pixels (" << s.writesPerPixel() << " per pixel, "
+     << 100.0 * s.redundant() << "% redundant), max " << s.maxCount << "\n";
+  for (int b = 0; b < OverdrawStats::kBuckets; ++b) {
+    const double share =
+        s.covered ? 100.0 * double(s.histogram[b]) / double(s.covered) : 0.0;
+    os << "  " << OverdrawStats::bucketLabel(b) << ": " << s.histogram[b]
+       << " px (" << share << "%)\n";
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
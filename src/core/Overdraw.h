@@ -0,0 +1,61 @@
+#pragma once
+#include "Framebuffer.h"
+#include "HugePages.h"
+#include "Math.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// How many times the line rasterizer writes each pixel. Lines are walked
+// exactly as renderLines() draws them, so the counts show how much of the
+// raster work lands on pixels that are already drawn.
+struct OverdrawMap {
+  int w = 0, h = 0;
+  LargeVector<uint32_t> counts; // w*h, row-major
+
+  OverdrawMap() = default;
+  OverdrawMap(int W, int H) { resize(W, H); }
+  // Resizes and zeroes all counts
+  void resize(int W, int H);
+  void clear();
+
+  void addLine(Vec2f a, Vec2f b);
+  void addLines(const ScreenLine *lines, size_t n);
+  void addLines(const ArenaSpan<ScreenLine> &lines) {
+    addLines(lines.data, lines.size);
+  }
+  void addLines(const ScreenLines &lines);
+};
+
+struct OverdrawStats {
+  // Pixels by write count: 1, 2, 3-4, 5-8, ..., 33-64, more than 64
+  static constexpr int kBuckets = 8;
+  static const char *bucketLabel(int bucket);
+
+  uint64_t writes = 0;  // pixel writes in total
+  uint64_t covered = 0; // pixels written at least once
+  uint32_t maxCount = 0;
+  uint64_t histogram[kBuckets] = {};
+
+  double writesPerPixel() const {
+    return covered ? double(writes) / double(covered) : 0.0;
+  }
+  // Share of writes that land on an already drawn pixel
+  double redundant() const {
+    return writes ? double(writes - covered) / double(writes) : 0.0;
+  }
+};
+
+OverdrawStats overdrawStats(const OverdrawMap &map);
+
+// Heatmap colour for a write count: blue at 1 write, through green and red,
+// to white at 64 or more. The scale is fixed, so views and models compare
+// directly.
+void overdrawColor(uint32_t count, uint8_t rgb[3]);
+
+// Colours every written pixel of `out` with overdrawColor(); unwritten
+// pixels are left alone.
+void drawOverdrawHeatmap(const OverdrawMap &map, const PixelView &out);
+
+void printOverdrawStats(std::ostream &os, const OverdrawStats &stats);
@@ -0,0 +1,279 @@
+#include "Panorama.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const size_t kBlock = 16384; // edges per parallel block
+const float kPi = 3.14159265358979f;
+
+// Eye-relative vertex positions, shared by every face
+Vec3f *eyeRelative(const MeshView &mesh, const Vec3f &eye,
+                   FrameArena &arena) {
+  Vec3f *rel = arena.local().alloc<Vec3f>(mesh.vertexCount);
+  parallelFor(0, mesh.vertexCount, 8192, [&](size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; ++i)
+      rel[i] = mesh.vertices[i] - eye;
+  });
+  return rel;
+}
+
+// Face coordinates of an eye-relative point: x right, y up, z depth along
+// the face's view direction (see CubeFace)
+Vec3f toFace(int face, const Vec3f &p) {
+  switch (face) {
+  case 0: return {p.z, p.y, p.x};    // +X
+  case 1: return {-p.z, p.y, -p.x};  // -X
+  case 2: return {p.x, p.z, p.y};    // +Y
+  case 3: return {p.x, -p.z, -p.y};  // -Y
+  case 4: return {-p.x, p.y, p.z};   // +Z
+  default: return {p.x, p.y, -p.z}; // -Z
+  }
+}
+
+// Clips AB (face coordinates) to the face's 90-degree view pyramid beyond
+// nearZ; false if nothing is left
+bool clipToFace(Vec3f &a, Vec3f &b, float nearZ) {
+  const float da[5] = {a.z - a.x, a.z + a.x, a.z - a.y, a.z + a.y,
+                       a.z - nearZ};
+  const float db[5] = {b.z - b.x, b.z + b.x, b.z - b.y, b.z + b.y,
+                       b.z - nearZ};
+  float t0 = 0.f, t1 = 1.f;
+  for (int i = 0; i < 5; ++i) {
+    if (da[i] < 0.f && db[i] < 0.f)
+      return false;
+    if (da[i] < 0.f)
+      t0 = std::max(t0, da[i] / (da[i] - db[i]));
+    else if (db[i] < 0.f)
+      t1 = std::min(t1, da[i] / (da[i] - db[i]));
+  }
+  if (t0 > t1)
+    return false;
+  const Vec3f a0 = a, d = b - a;
+  a = a0 + d * t0;
+  b = a0 + d * t1;
+  return true;
+}
+
+Vec2f projectFace(const Vec3f &p, float size) {
+  return {(p.x / p.z * 0.5f + 0.5f) * size, (0.5f - p.y / p.z * 0.5f) * size};
+}
+
+// Longitude across (-Z in the middle, +X right), latitude down
+Vec2f toEquirect(const Vec3f &p, float w, float h) {
+  const float lon = std::atan2(p.x, -p.z);
+  const float lat = std::atan2(p.y, std::sqrt(p.x * p.x + p.z * p.z));
+  return {(lon / (2.f * kPi) + 0.5f) * w, (0.5f - lat / kPi) * h};
+}
+
+// Pieces an edge is traced with: about one per kPixelsPerPiece of arc, more
+// towards the poles where longitude stretches
+int arcPieces(const Vec3f &a, const Vec3f &b, float pixelsPerRadian) {
+  const float kPixelsPerPiece = 3.f;
+  const float la = length(a), lb = length(b);
+  if (la <= 0.f || lb <= 0.f)
+    return 1;
+  const float c = std::max(-1.f, std::min(1.f, dot(a, b) / (la * lb)));
+  const float cosLat =
+      std::max(0.05f, std::min(std::sqrt(a.x * a.x + a.z * a.z) / la,
+                               std::sqrt(b.x * b.x + b.z * b.z) / lb));
+  const float n =
+      std::ceil(std::acos(c) * pixelsPerRadian / (kPixelsPerPiece * cosLat));
+  return int(std::max(1.f, std::min(n, 512.f)));
+}
+
+void draw(const PixelView &target, const ScreenLine *lines, size_t n,
+          const uint8_t color[3]) {
+  for (size_t i = 0; i < n; ++i)
+    drawLine(target, int(std::lround(lines[i].a.x)),
+             int(std::lround(lines[i].a.y)), int(std::lround(lines[i].b.x)),
+             int(std::lround(lines[i].b.y)), color[0], color[1], color[2]);
+}
+
+// Edge ids to draw: the feature list or every edge
+struct EdgeList {
+  const uint32_t *ids;
+  size_t count;
+  size_t operator[](size_t i) const { return ids ? ids[i] : i; }
+};
+
+EdgeList edgeList(const PanoramaDesc &d, const MeshView &mesh) {
+  if (d.mode == RenderMode::FeatureEdges && mesh.classified)
+    return {mesh.featureEdges, mesh.featureCount};
+  return {nullptr, mesh.edgeCount};
+}
+} // namespace
+
+size_t renderCubeMap(const PanoramaDesc &desc, MeshView mesh,
+                     const PixelView faces[6], FrameArena &arena) {
+  const EdgeList edges = edgeList(desc, mesh);
+  R3D_PROBE2(render_start, edges.count, 6);
+  FrameArena::Local &scratch = arena.local();
+  const Vec3f *rel = eyeRelative(mesh, desc.eye, arena);
+
+  // 1) Bin: which faces each edge reaches, and per-block counts per face
+  const size_t nBlocks = (edges.count + kBlock - 1) / kBlock;
+  uint8_t *mask = scratch.alloc<uint8_t>(edges.count);
+  size_t *counts = scratch.alloc<size_t>(nBlocks * 6);
+  parallelFor(0, nBlocks, 1, [&](size_t lo, size_t hi) {
+    for (size_t b = lo; b < hi; ++b) {
+      size_t *c = counts + b * 6;
+      std::fill(c, c + 6, size_t(0));
+      const size_t end = std::min(edges.count, (b + 1) * kBlock);
+      for (size_t i = b * kBlock; i < end; ++i) {
+        const auto &e = mesh.edges[edges[i]];
+        uint8_t m = 0;
+        for (int f = 0; f < 6; ++f) {
+          Vec3f fa = toFace(f, rel[e.first]), fb = toFace(f, rel[e.second]);
+          if (clipToFace(fa, fb, desc.nearZ)) {
+            m |= uint8_t(1u << f);
+            ++c[f];
+          }
+        }
+        mask[i] = m;
+      }
+    }
+  });
+
+  // Each face's lines are contiguous, blocks in order within a face
+  size_t faceBase[7] = {0};
+  for (int f = 0; f < 6; ++f) {
+    size_t at = faceBase[f];
+    for (size_t b = 0; b < nBlocks; ++b) {
+      const size_t n = counts[b * 6 + f];
+      counts[b * 6 + f] = at; // now the block's first slot
+      at += n;
+    }
+    faceBase[f + 1] = at;
+  }
+  ScreenLine *lines = scratch.alloc<ScreenLine>(faceBase[6]);
+
+  // 2) Clip and project into every face an edge was binned to
+  parallelFor(0, nBlocks, 1, [&](size_t lo, size_t hi) {
+    for (size_t b = lo; b < hi; ++b) {
+      size_t *slot = counts + b * 6;
+      const size_t end = std::min(edges.count, (b + 1) * kBlock);
+      for (size_t i = b * kBlock; i < end; ++i) {
+        if (!mask[i])
+          continue;
+        const auto &e = mesh.edges[edges[i]];
+        for (int f = 0; f < 6; ++f) {
+          if (!(mask[i] & (1u << f)))
+            continue;
+          Vec3f fa = toFace(f, rel[e.first]), fb = toFace(f, rel[e.second]);
+          clipToFace(fa, fb, desc.nearZ);
+          const float size = float(faces[f].w);
+          lines[slot[f]++] = {projectFace(fa, size), projectFace(fb, size)};
+        }
+      }
+    }
+  });
+
+  // 3) Faces are separate pixels, so they rasterize in parallel
+  R3D_PROBE1(raster_start, faceBase[6]);
+  parallelFor(0, 6, 1, [&](size_t lo, size_t hi) {
+    for (size_t f = lo; f < hi; ++f)
+      if (faces[f].data)
+        draw(faces[f], lines + faceBase[f], faceBase[f + 1] - faceBase[f],
+             desc.color);
+  });
+  R3D_PROBE1(raster_end, faceBase[6]);
+  R3D_PROBE1(render_end, faceBase[6]);
+  return faceBase[6];
+}
+
+void cubeCrossViews(const PixelView &image, PixelView faces[6]) {
+  const int s = image.w / 4;
+  // Cell (column, row) of each face in the cross
+  static const int kCell[6][2] = {{2, 1}, {0, 1}, {1, 0},
+                                  {1, 2}, {3, 1}, {1, 1}};
+  for (int f = 0; f < 6; ++f) {
+    PixelView &v = faces[f];
+    v.data = image.data + size_t(kCell[f][1] * s) * image.stride +
+             size_t(kCell[f][0] * s) * 3;
+    v.w = s;
+    v.h = std::min(s, image.h - kCell[f][1] * s);
+    v.stride = image.stride;
+  }
+}
+
+size_t renderEquirect(const PanoramaDesc &desc, MeshView mesh,
+                      const PixelView &target, FrameArena &arena) {
+  const EdgeList edges = edgeList(desc, mesh);
+  R3D_PROBE2(render_start, edges.count, 1);
+  FrameArena::Local &scratch = arena.local();
+  const Vec3f *rel = eyeRelative(mesh, desc.eye, arena);
+  const float w = float(target.w), h = float(target.h);
+  const float pixelsPerRadian = w / (2.f * kPi);
+  const float near2 = desc.nearZ * desc.nearZ;
+
+  // 1) Room per block: each piece is one segment, or two across the seam
+  const size_t nBlocks = (edges.count + kBlock - 1) / kBlock;
+  size_t *slots = scratch.alloc<size_t>(nBlocks + 1);
+  parallelFor(0, nBlocks, 1, [&](size_t lo, size_t hi) {
+    for (size_t b = lo; b < hi; ++b) {
+      size_t n = 0;
+      const size_t end = std::min(edges.count, (b + 1) * kBlock);
+      for (size_t i = b * kBlock; i < end; ++i) {
+        const auto &e = mesh.edges[edges[i]];
+        n += 2 * size_t(arcPieces(rel[e.first], rel[e.second],
+                                  pixelsPerRadian));
+      }
+      slots[b + 1] = n;
+    }
+  });
+  slots[0] = 0;
+  for (size_t b = 0; b < nBlocks; ++b)
+    slots[b + 1] += slots[b];
+  ScreenLine *lines = scratch.alloc<ScreenLine>(slots[nBlocks]);
+  size_t *written = scratch.alloc<size_t>(nBlocks);
+
+  // 2) Trace every edge along its arc; points inside the near sphere are
+  // left out
+  parallelFor(0, nBlocks, 1, [&](size_t lo, size_t hi) {
+    for (size_t b = lo; b < hi; ++b) {
+      ScreenLine *out = lines + slots[b];
+      size_t n = 0;
+      const size_t end = std::min(edges.count, (b + 1) * kBlock);
+      for (size_t i = b * kBlock; i < end; ++i) {
+        const auto &e = mesh.edges[edges[i]];
+        const Vec3f a = rel[e.first], d = rel[e.second] - a;
+        const int pieces = arcPieces(a, rel[e.second], pixelsPerRadian);
+        Vec3f p0 = a;
+        Vec2f s0 = toEquirect(p0, w, h);
+        for (int k = 1; k <= pieces; ++k) {
+          const Vec3f p1 = a + d * (float(k) / float(pieces));
+          const Vec2f s1 = toEquirect(p1, w, h);
+          if (dot(p0, p0) >= near2 && dot(p1, p1) >= near2) {
+            if (std::abs(s1.x - s0.x) <= 0.5f * w) {
+              out[n++] = {s0, s1};
+            } else {
+              // Crosses the seam: draw it off both sides
+              const float shift = s1.x > s0.x ? -w : w;
+              out[n++] = {s0, {s1.x + shift, s1.y}};
+              out[n++] = {{s0.x - shift, s0.y}, s1};
+            }
+          }
+          p0 = p1;
+          s0 = s1;
+        }
+      }
+      written[b] = n;
+    }
+  });
+
+  // Compact the blocks in order
+  size_t total = nBlocks ? written[0] : 0;
+  for (size_t b = 1; b < nBlocks; ++b) {
+    std::copy(lines + slots[b], lines + slots[b] + written[b], lines + total);
+    total += written[b];
+  }
+
+  R3D_PROBE1(raster_start, total);
+  if (target.data)
+    draw(target, lines, total, desc.color);
+  R3D_PROBE1(raster_end, total);
+  R3D_PROBE1(render_end, total);
+  return total;
+}
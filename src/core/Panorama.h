@@ -0,0 +1,41 @@
+#pragma once
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Math.h"
+#include "Mesh.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <cstdint>
+
+// The six 90-degree views of a cube map, in the usual order. Side faces
+// have +Y up; the top face has -Z down and the bottom face -Z up, so the
+// faces meet along their edges in the cross layout of cubeCrossViews().
+enum class CubeFace : uint8_t { PosX, NegX, PosY, NegY, PosZ, NegZ };
+
+// A panorama seen from one point; the mesh is drawn in world coordinates.
+struct PanoramaDesc {
+  Vec3f eye{0.f, 0.f, 0.f};
+  float nearZ = 0.05f;
+  RenderMode mode = RenderMode::AllEdges;
+  uint8_t color[3] = {230, 230, 240};
+};
+
+// Draws the mesh into the six faces (indexed by CubeFace, each square) in
+// one pass: vertices are made eye-relative once, every edge is binned to the
+// faces whose view it can touch, then clipped and projected per face with
+// nothing more than the face's axis swizzle. Returns the lines drawn.
+size_t renderCubeMap(const PanoramaDesc &desc, MeshView mesh,
+                     const PixelView faces[6], FrameArena &arena);
+
+// Views of the six faces inside a 4x3 cross image (square faces of side
+// image.w / 4):          +Y
+//                   -X   -Z   +X   +Z
+//                        -Y
+void cubeCrossViews(const PixelView &image, PixelView faces[6]);
+
+// Draws the mesh as an equirectangular panorama: longitude across (-Z in
+// the middle, +X to the right), latitude down. Edges become curves, traced
+// as short segments, and wrap across the left/right seam. Returns the
+// segments drawn.
+size_t renderEquirect(const PanoramaDesc &desc, MeshView mesh,
+                      const PixelView &target, FrameArena &arena);
@@ -0,0 +1,298 @@
+#include "PngWriter.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+// CRC-32 (PNG chunks), eight bytes per step (slicing-by-8): uncompressed
+// image data is checksummed at several times the speed of a byte loop.
+// Tables built on first use.
+uint32_t crc32(const uint8_t *p, size_t n, uint32_t crc = 0) {
+  using Tables = std::array<std::array<uint32_t, 256>, 8>;
+  static const Tables table = [] {
+    Tables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+      for (int k = 1; k < 8; ++k)
+        t[k][i] = t[0][t[k - 1][i] & 0xff] ^ (t[k - 1][i] >> 8);
+    return t;
+  }();
+  crc = ~crc;
+  for (; n >= 8; p += 8, n -= 8) {
+    const uint32_t lo = crc ^ (uint32_t(p[0]) | uint32_t(p[1]) << 8 |
+                               uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+    crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+          table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+          table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+  }
+  for (; n > 0; ++p, --n)
+    crc = table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+uint32_t adler32(const uint8_t *p, size_t n) {
+  uint32_t a = 1, b = 0;
+  while (n > 0) {
+    const size_t chunk = std::min<size_t>(n, 5552); // no overflow before mod
+    for (size_t i = 0; i < chunk; ++i) {
+      a += p[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    p += chunk;
+    n -= chunk;
+  }
+  return b << 16 | a;
+}
+
+void putBE32(std::vector<uint8_t> &out, uint32_t v) {
+  out.push_back(uint8_t(v >> 24));
+  out.push_back(uint8_t(v >> 16));
+  out.push_back(uint8_t(v >> 8));
+  out.push_back(uint8_t(v));
+}
+
+// Deflate bit stream: bits go out LSB first, Huffman codes MSB first
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : m_out(out) {}
+
+  void bits(uint32_t value, int count) {
+    m_acc |= uint64_t(value) << m_count;
+    m_count += count;
+    while (m_count >= 8) {
+      m_out.push_back(uint8_t(m_acc));
+      m_acc >>= 8;
+      m_count -= 8;
+    }
+  }
+  void code(uint32_t code, int length) {
+    uint32_t rev = 0;
+    for (int i = 0; i < length; ++i)
+      rev |= ((code >> i) & 1u) << (length - 1 - i);
+    bits(rev, length);
+  }
+  void flush() {
+    if (m_count > 0)
+      m_out.push_back(uint8_t(m_acc));
+    m_acc = 0;
+    m_count = 0;
+  }
+
+private:
+  std::vector<uint8_t> &m_out;
+  uint64_t m_acc = 0;
+  int m_count = 0;
+};
+
+// Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+void putSymbol(BitWriter &w, unsigned sym) {
+  if (sym < 144)
+    w.code(0x30 + sym, 8);
+  else if (sym < 256)
+    w.code(0x190 + sym - 144, 9);
+  else if (sym < 280)
+    w.code(sym - 256, 7);
+  else
+    w.code(0xc0 + sym - 280, 8);
+}
+
+const uint16_t kLengthBase[29] = {3,  4,  5,  6,   7,   8,   9,   10,  11, 13,
+                                  15, 17, 19, 23,  27,  31,  35,  43,  51, 59,
+                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,
+                                13,   17,   25,   33,   49,   65,    97,
+                                129,  193,  257,  385,  513,  769,   1025,
+                                1537, 2049, 3073, 4097, 6145, 8193,  12289,
+                                16385, 24577};
+const uint8_t kDistExtra[30] = {0, 0, 0,  0,  1,  1,  2,  2,  3,  3,
+                                4, 4, 5,  5,  6,  6,  7,  7,  8,  8,
+                                9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+void putMatch(BitWriter &w, unsigned length, unsigned dist) {
+  int l = 28;
+  while (kLengthBase[l] > length)
+    --l;
+  putSymbol(w, 257 + unsigned(l));
+  w.bits(length - kLengthBase[l], kLengthExtra[l]);
+  int d = 29;
+  while (kDistBase[d] > dist)
+    --d;
+  w.code(unsigned(d), 5);
+  w.bits(dist - kDistBase[d], kDistExtra[d]);
+}
+
+// zlib stream of one fixed-Huffman block; matches come from a hash of the
+// next three bytes, one candidate per hash
+void deflate(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+  const size_t kWindow = 32768, kMaxMatch = 258, kHashBits = 15;
+  out.push_back(0x78); // deflate, 32K window
+  out.push_back(0x01); // fastest, no dictionary
+  BitWriter w(out);
+  w.bits(1, 1); // final block
+  w.bits(1, 2); // fixed Huffman
+
+  std::vector<int64_t> head(size_t(1) << kHashBits, -1);
+  auto hash = [&](size_t i) {
+    const uint32_t v = uint32_t(in[i]) | uint32_t(in[i + 1]) << 8 |
+                       uint32_t(in[i + 2]) << 16;
+    return (v * 2654435761u) >> (32 - kHashBits);
+  };
+  const size_t n = in.size();
+  size_t i = 0;
+  while (i < n) {
+    size_t best = 0;
+    if (i + 3 <= n) {
+      const uint32_t h = hash(i);
+      const int64_t cand = head[h];
+      head[h] = int64_t(i);
+      if (cand >= 0 && i - size_t(cand) <= kWindow) {
+        const size_t limit = std::min(kMaxMatch, n - i);
+        const uint8_t *a = &in[size_t(cand)], *b = &in[i];
+        while (best < limit && a[best] == b[best])
+          ++best;
+        if (best >= 3) {
+          putMatch(w, unsigned(best), unsigned(i - size_t(cand)));
+          // Index a few positions inside the match so runs chain on
+          for (size_t k = 1; k < best && i + k + 3 <= n && k < 16; ++k)
+            head[hash(i + k)] = int64_t(i + k);
+          i += best;
+          continue;
+        }
+      }
+    }
+    putSymbol(w, in[i]);
+    ++i;
+  }
+  putSymbol(w, 256); // end of block
+  w.flush();
+  putBE32(out, adler32(in.data(), in.size()));
+}
+
+// zlib stream of uncompressed (stored) blocks, up to 64K each
+void store(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+  const size_t kMaxBlock = 65535;
+  out.push_back(0x78);
+  out.push_back(0x01);
+  size_t i = 0;
+  do {
+    const size_t n = std::min(kMaxBlock, in.size() - i);
+    const uint8_t header[5] = {
+        uint8_t(i + n == in.size()), // final block, type 0
+        uint8_t(n), uint8_t(n >> 8), uint8_t(~n), uint8_t(~n >> 8)};
+    out.insert(out.end(), header, header + 5);
+    out.insert(out.end(), in.data() + i, in.data() + i + n);
+    i += n;
+  } while (i < in.size());
+  putBE32(out, adler32(in.data(), in.size()));
+}
+
+void putChunk(std::vector<uint8_t> &out, const char type[4],
+              const uint8_t *data, size_t n) {
+  putBE32(out, uint32_t(n));
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + n);
+  putBE32(out, crc32(&out[start], n + 4));
+}
+} // namespace
+
+void encodePNG(const PixelView &img, std::vector<uint8_t> &out,
+               bool compress) {
+  if (img.layout != PixelLayout::RowMajor) {
+    std::vector<uint8_t> rows(size_t(img.w) * img.h * 3);
+    copyRows(img, 0, img.h, rows.data(), size_t(img.w) * 3);
+    encodePNG(PixelView{rows.data(), img.w, img.h, size_t(img.w) * 3}, out,
+              compress);
+    return;
+  }
+  R3D_PROBE2(encode_start, "png", size_t(img.w) * img.h * 3);
+  const size_t rowBytes = size_t(img.w) * 3;
+
+  // Filtered scanlines: a filter byte, then the row's residuals
+  std::vector<uint8_t> raw((rowBytes + 1) * size_t(img.h));
+  std::vector<uint8_t> sub(rowBytes), up(rowBytes);
+  for (int y = 0; y < img.h && !compress; ++y) {
+    uint8_t *dst = &raw[size_t(y) * (rowBytes + 1)];
+    dst[0] = 0;
+    std::memcpy(dst + 1, img.data + size_t(y) * img.stride, rowBytes);
+  }
+  for (int y = 0; y < img.h && compress; ++y) {
+    const uint8_t *row = img.data + size_t(y) * img.stride;
+    const uint8_t *prev = y > 0 ? row - img.stride : nullptr;
+    unsigned costNone = 0, costSub = 0, costUp = 0;
+    for (size_t i = 0; i < rowBytes; ++i) {
+      sub[i] = uint8_t(row[i] - (i >= 3 ? row[i - 3] : 0));
+      up[i] = uint8_t(row[i] - (prev ? prev[i] : 0));
+      costNone += row[i] < 128 ? row[i] : 256 - row[i];
+      costSub += sub[i] < 128 ? sub[i] : 256 - sub[i];
+      costUp += up[i] < 128 ? up[i] : 256 - up[i];
+    }
+    uint8_t *dst = &raw[size_t(y) * (rowBytes + 1)];
+    if (costSub <= costNone && costSub <= costUp) {
+      dst[0] = 1;
+      std::memcpy(dst + 1, sub.data(), rowBytes);
+    } else if (costUp <= costNone) {
+      dst[0] = 2;
+      std::memcpy(dst + 1, up.data(), rowBytes);
+    } else {
+      dst[0] = 0;
+      std::memcpy(dst + 1, row, rowBytes);
+    }
+  }
+
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a,
+                                        '\n'};
+  out.assign(kSignature, kSignature + 8);
+  uint8_t ihdr[13];
+  const uint32_t w = uint32_t(img.w), h = uint32_t(img.h);
+  const uint8_t dims[8] = {uint8_t(w >> 24), uint8_t(w >> 16), uint8_t(w >> 8),
+                           uint8_t(w),       uint8_t(h >> 24), uint8_t(h >> 16),
+                           uint8_t(h >> 8),  uint8_t(h)};
+  std::memcpy(ihdr, dims, 8);
+  ihdr[8] = 8;  // bits per channel
+  ihdr[9] = 2;  // RGB
+  ihdr[10] = 0; // deflate
+  ihdr[11] = 0; // adaptive filtering
+  ihdr[12] = 0; // no interlace
+  putChunk(out, "IHDR", ihdr, sizeof(ihdr));
+  // IDAT is deflated straight into `out`; its length is filled in after
+  out.reserve(out.size() + (compress ? raw.size() / 8
+                                     : raw.size() + raw.size() / 65535 * 5) +
+              64);
+  const size_t idat = out.size();
+  putBE32(out, 0);
+  out.insert(out.end(), {'I', 'D', 'A', 'T'});
+  if (compress)
+    deflate(raw, out);
+  else
+    store(raw, out);
+  const size_t zBytes = out.size() - idat - 8;
+  for (int k = 0; k < 4; ++k)
+    out[idat + size_t(k)] = uint8_t(zBytes >> (24 - 8 * k));
+  putBE32(out, crc32(&out[idat + 4], zBytes + 4));
+  putChunk(out, "IEND", nullptr, 0);
+  // Encoding into memory cannot fail; savePNG() reports the write
+  R3D_PROBE2(encode_end, "png", true);
+}
+
+bool savePNG(const std::string &path, const Framebuffer &img,
+             bool compress) {
+  std::vector<uint8_t> png;
+  encodePNG(img.view(), png, compress);
+  std::ofstream f(path, std::ios::binary);
+  f.write(reinterpret_cast<const char *>(png.data()),
+          std::streamsize(png.size()));
+  return f.good();
+}
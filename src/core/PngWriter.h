@@ -0,0 +1,19 @@
+#pragma once
+#include "Framebuffer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encodes RGB8 pixels as a PNG: each row gets the None, Sub or Up filter,
+// whichever leaves the smallest residuals, and the image data is one
+// fixed-Huffman deflate block with greedy LZ77 matches. Wireframes are
+// mostly flat background, which this shrinks 20-100x at a few ms per
+// megapixel; it is not meant to compete with zlib on photographs. Without
+// `compress`, rows are stored unfiltered in uncompressed deflate blocks: a
+// file as large as a PPM, written at about the same speed.
+void encodePNG(const PixelView &img, std::vector<uint8_t> &out,
+               bool compress = true);
+
+// Writes the framebuffer as a PNG file; false on I/O errors.
+bool savePNG(const std::string &path, const Framebuffer &img,
+             bool compress = true);
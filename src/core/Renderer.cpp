@@ -1,7 +1,12 @@
 #include "Renderer.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 
-bool Renderer::clipToNear(Vec3f &a, Vec3f &b, float nearZ) {
+namespace {
+bool clipToNear(Vec3f &a, Vec3f &b, float nearZ) {
   // camera-space: z < 0 is in front of the camera
   float da = -a.z, db = -b.z;
   bool aIn = da >= nearZ, bIn = db >= nearZ;
@@ -19,7 +24,7 @@ bool Renderer::clipToNear(Vec3f &a, Vec3f &b, float nearZ) {
   return true;
 }
 
-bool Renderer::projectToScreen(const Vec4f &clip, Vec2f &out) const {
+bool projectToScreen(const Vec4f &clip, const RenderDesc &d, Vec2f &out) {
   float w = clip.w;
   if (std::abs(w) < 1e-6f)
     return false;
@@ -31,22 +36,76 @@ bool Renderer::projectToScreen(const Vec4f &clip, Vec2f &out) const {
     // keep generous bounds to avoid disappearing during pan; renderer still
     // draws offscreen okay
   }
-  out.x = (ndcX * 0.5f + 0.5f) * m_width;
-  out.y = (1.0f - (ndcY * 0.5f + 0.5f)) * m_height;
+  out.x = (ndcX * 0.5f + 0.5f) * d.width;
+  out.y = (1.0f - (ndcY * 0.5f + 0.5f)) * d.height;
   return std::isfinite(out.x) && std::isfinite(out.y);
 }
 
-std::vector<ScreenLine> Renderer::buildProjectedLines(const Mat4 &view,
-                                                      const Mat4 &proj,
-                                                      const Mesh &mesh,
-                                                      float nearZ) const {
-  std::vector<ScreenLine> out;
-  out.reserve(mesh.edges.size());
+// Where projectLines() writes: interleaved lines or coordinate streams.
+// Both hand out storage for n lines, write line i, and move a run of lines
+// towards the front when block slices are compacted.
+struct LineArray {
+  using Result = ArenaSpan<ScreenLine>;
+  Result lines;
 
-  Mat4 vm = view * m_model;
-  Mat4 pvm = proj * vm;
+  LineArray(FrameArena::Local &arena, size_t n)
+      : lines(arena.span<ScreenLine>(n)) {}
+  void set(size_t i, Vec2f a, Vec2f b) const { lines[i] = {a, b}; }
+  void moveDown(size_t from, size_t to, size_t n) const {
+    std::copy(lines.data + from, lines.data + from + n, lines.data + to);
+  }
+  Result finish(size_t n) {
+    lines.size = n;
+    return lines;
+  }
+};
+
+struct LineStreams {
+  using Result = ScreenLines;
+  Result lines;
+  size_t capacity;
+
+  LineStreams(FrameArena::Local &arena, size_t n)
+      : capacity(ScreenLines::padded(n)) {
+    for (float **s : {&lines.ax, &lines.ay, &lines.bx, &lines.by})
+      *s = arena.alloc<float>(capacity);
+  }
+  void set(size_t i, Vec2f a, Vec2f b) const {
+    lines.ax[i] = a.x;
+    lines.ay[i] = a.y;
+    lines.bx[i] = b.x;
+    lines.by[i] = b.y;
+  }
+  void moveDown(size_t from, size_t to, size_t n) const {
+    for (float *s : {lines.ax, lines.ay, lines.bx, lines.by})
+      std::copy(s + from, s + from + n, s + to);
+  }
+  Result finish(size_t n) {
+    lines.size = n;
+    for (float *s : {lines.ax, lines.ay, lines.bx, lines.by})
+      std::fill(s + n, s + ScreenLines::padded(n), 0.f);
+    return lines;
+  }
+};
 
-  for (const auto &e : mesh.edges) {
+// Projects edges [begin, end), or edges ids[begin, end) when ids is set;
+// with `smoothOnly`, edges of any other kind are left out (they were drawn
+// with the feature edges). Writes at most end - begin lines to `out` from
+// line `slot` on; returns how many. The counters stay in registers and are
+// added to `stats` once at the end.
+template <typename Out>
+size_t projectEdges(const RenderDesc &d, const Mat4 &vm, const MeshView &mesh,
+                    const uint32_t *ids, const EdgeKind *smoothOnly,
+                    size_t begin, size_t end, const Out &out, size_t slot,
+                    RenderStats &stats) {
+  size_t n = 0, rejected = 0, clipped = 0, left = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const size_t id = ids ? ids[i] : i;
+    if (smoothOnly && smoothOnly[id] != EdgeKind::Smooth) {
+      ++left;
+      continue;
+    }
+    const auto &e = mesh.edges[id];
     Vec3f va = mesh.vertices[e.first];
     Vec3f vb = mesh.vertices[e.second];
 
@@ -56,17 +115,354 @@ std::vector<ScreenLine> Renderer::buildProjectedLines(const Mat4 &view,
     Vec3f ac{a4.x, a4.y, a4.z};
     Vec3f bc{b4.x, b4.y, b4.z};
 
-    if (!clipToNear(ac, bc, nearZ))
+    const bool aIn = -ac.z >= d.nearZ, bIn = -bc.z >= d.nearZ;
+    if (!aIn && !bIn) {
+      ++rejected;
       continue;
+    }
+    if (!aIn || !bIn) {
+      ++clipped;
+      clipToNear(ac, bc, d.nearZ);
+    }
 
     // project
-    Vec4f ap = mul(proj, {ac.x, ac.y, ac.z, 1.f});
-    Vec4f bp = mul(proj, {bc.x, bc.y, bc.z, 1.f});
+    Vec4f ap = mul(d.proj, {ac.x, ac.y, ac.z, 1.f});
+    Vec4f bp = mul(d.proj, {bc.x, bc.y, bc.z, 1.f});
 
     Vec2f sa, sb;
-    if (projectToScreen(ap, sa) && projectToScreen(bp, sb)) {
-      out.push_back({sa, sb});
+    if (projectToScreen(ap, d, sa) && projectToScreen(bp, d, sb)) {
+      out.set(slot + n++, sa, sb);
+    }
+  }
+  const size_t count = end - begin - left;
+  stats.processed += count;
+  stats.rejected += rejected;
+  stats.nearClipped += clipped;
+  stats.projectFailed += count - rejected - n;
+  stats.emitted += n;
+  return n;
+}
+
+// Draws the lines in order; returns how many, which is fewer only when the
+// deadline passed (the clock is read every kDeadlineCheck lines)
+template <typename Lines>
+size_t rasterize(const RenderDesc &d, const Lines &lines) {
+  const size_t kDeadlineCheck = 256;
+  const bool bounded = d.deadline != kNoDeadline;
+  R3D_PROBE1(raster_start, lines.size);
+  size_t i = 0;
+  for (; i < lines.size; ++i) {
+    if (bounded && i % kDeadlineCheck == 0 && RenderClock::now() >= d.deadline)
+      break;
+    const ScreenLine ln = lines[i];
+    int x0 = static_cast<int>(std::lround(ln.a.x));
+    int y0 = static_cast<int>(std::lround(ln.a.y));
+    int x1 = static_cast<int>(std::lround(ln.b.x));
+    int y1 = static_cast<int>(std::lround(ln.b.y));
+    drawLine(d.target, x0, y0, x1, y1, d.color[0], d.color[1], d.color[2]);
+  }
+  R3D_PROBE1(raster_end, i);
+  return i;
+}
+
+// A run of edges (or edge ids) of one model, and where its lines start in
+// the output before compaction. Bounded renders also draw in tiers:
+// feature edges (tier 0) before the smooth edges (tier 1).
+struct EdgeBlock {
+  size_t model, begin, end, slot;
+  const uint32_t *ids;
+  const EdgeKind *smoothOnly;
+  unsigned tier;
+  float importance;
+};
+
+// A block's counters, alone on their cache line
+struct alignas(FrameArena::kCacheLine) BlockStats {
+  RenderStats stats;
+};
+
+// Apparent size of an object: bounding radius over camera-space distance
+float importance(const Bounds &b, const Mat4 &vm, float nearZ) {
+  const Vec3f c = b.center();
+  const Vec4f p = mul(vm, {c.x, c.y, c.z, 1.f});
+  return b.radius() / std::max(std::abs(p.z), nearZ);
+}
+
+// Projects the mesh once per model matrix, skipping hidden objects and
+// objects whose bounds lie outside the view. Every block of edges projects
+// into its own slice of one output span (model-major), and the slices are
+// then compacted in order, so the result matches a serial run. Only the
+// calling thread touches the arena: a render can run while its caller helps
+// with another render's blocks.
+template <typename Out>
+typename Out::Result projectLines(const RenderDesc &d, const MeshView &mesh,
+                                  const Mat4 *models, size_t nModels,
+                                  FrameArena &arena) {
+  const size_t kBlock = 16384; // edges per block
+  const uint32_t *ids =
+      d.mode == RenderMode::FeatureEdges && mesh.classified ? mesh.featureEdges
+                                                            : nullptr;
+  const size_t n = ids ? mesh.featureCount : mesh.edgeCount;
+
+  // With a deadline, transforming gets the first half of the time left and
+  // rasterizing the rest
+  const bool bounded = d.deadline != kNoDeadline;
+  RenderClock::time_point projectBy = d.deadline;
+  if (bounded) {
+    const RenderClock::time_point now = RenderClock::now();
+    if (d.deadline > now)
+      projectBy = now + (d.deadline - now) / 2;
+  }
+  const bool tiered = bounded && !ids && mesh.classified && mesh.edgeKinds &&
+                      mesh.featureCount > 0;
+
+  // Calls fn(model, object, begin, end) for every run of runIds (or edges)
+  // to draw; object is null for meshes without objects. Edges of skipped
+  // objects are counted into `skipped` when it is set.
+  auto forEachRun = [&](const uint32_t *runIds, size_t count,
+                        RenderStats *skipped, auto &&fn) {
+    for (size_t m = 0; m < nModels; ++m) {
+      if (mesh.objectCount == 0) {
+        if (count > 0)
+          fn(m, (const MeshObject *)nullptr, size_t(0), count);
+        continue;
+      }
+      // Side planes only: clipping decides what the near and far planes cut
+      const Frustum frustum(d.proj * (d.view * models[m]));
+      for (size_t k = 0; k < mesh.objectCount; ++k) {
+        const MeshObject &o = mesh.objects[k];
+        size_t begin = size_t(o.firstEdge);
+        size_t end = size_t(o.firstEdge + o.edgeCount);
+        if (runIds) {
+          begin =
+              size_t(std::lower_bound(runIds, runIds + count, begin) - runIds);
+          end = size_t(std::lower_bound(runIds, runIds + count, end) - runIds);
+        }
+        if (d.hiddenObjects && d.hiddenObjects[k]) {
+          if (skipped)
+            skipped->hidden += end - begin;
+        } else if (frustum.outside(o.bounds, 4)) {
+          if (skipped) {
+            skipped->frustumCulled += end - begin;
+            ++skipped->objectsCulled;
+          }
+        } else if (begin < end) {
+          fn(m, &o, begin, end);
+        }
+      }
+    }
+  };
+  // Calls fn(block) for every block of every run, tier by tier
+  auto forEachBlock = [&](RenderStats *skipped, auto &&fn) {
+    auto split = [&](const uint32_t *runIds, const EdgeKind *smoothOnly,
+                     unsigned tier) {
+      return [&, runIds, smoothOnly, tier](size_t m, const MeshObject *o,
+                                           size_t begin, size_t end) {
+        const float key =
+            bounded && o ? importance(o->bounds, d.view * models[m], d.nearZ)
+                         : 0.f;
+        for (size_t b = begin; b < end; b += kBlock)
+          fn(EdgeBlock{m, b, std::min(end, b + kBlock), 0, runIds, smoothOnly,
+                       tier, key});
+      };
+    };
+    if (tiered) {
+      forEachRun(mesh.featureEdges, mesh.featureCount, nullptr,
+                 split(mesh.featureEdges, nullptr, 0));
+      forEachRun(nullptr, mesh.edgeCount, skipped,
+                 split(nullptr, mesh.edgeKinds, 1));
+    } else {
+      forEachRun(ids, n, skipped, split(ids, nullptr, 0));
+    }
+  };
+
+  RenderStats stats;
+  size_t nBlocks = 0, total = 0;
+  forEachBlock(&stats, [&](const EdgeBlock &b) {
+    ++nBlocks;
+    total += b.end - b.begin;
+  });
+  Out out(arena.local(), total);
+  if (total == 0) {
+    if (d.stats)
+      *d.stats = stats;
+    return out.finish(0);
+  }
+  ArenaSpan<EdgeBlock> blocks = arena.local().span<EdgeBlock>(nBlocks);
+  size_t nb = 0;
+  forEachBlock(nullptr, [&](const EdgeBlock &b) { blocks[nb++] = b; });
+  if (bounded) {
+    std::sort(blocks.begin(), blocks.end(),
+              [](const EdgeBlock &a, const EdgeBlock &b) {
+                if (a.tier != b.tier)
+                  return a.tier < b.tier;
+                if (a.importance != b.importance)
+                  return a.importance > b.importance;
+                if (a.model != b.model)
+                  return a.model < b.model;
+                return a.begin < b.begin;
+              });
+  }
+  size_t slot = 0;
+  for (EdgeBlock &b : blocks) {
+    b.slot = slot;
+    slot += b.end - b.begin;
+  }
+
+  // Once the time for transforming is up, blocks are skipped whole
+  auto runBlock = [&](const EdgeBlock &b, RenderStats &s) -> size_t {
+    if (bounded && RenderClock::now() >= projectBy) {
+      size_t drawable = b.end - b.begin;
+      if (b.smoothOnly) {
+        const uint32_t *f = mesh.featureEdges, *fEnd = f + mesh.featureCount;
+        drawable -= size_t(std::lower_bound(f, fEnd, uint32_t(b.end)) -
+                           std::lower_bound(f, fEnd, uint32_t(b.begin)));
+      }
+      s.deadlineSkipped += drawable;
+      return 0;
+    }
+    return projectEdges(d, d.view * models[b.model], mesh, b.ids,
+                        b.smoothOnly, b.begin, b.end, out, b.slot, s);
+  };
+
+  if (nBlocks == 1) {
+    const size_t n = runBlock(blocks[0], stats);
+    if (d.stats)
+      *d.stats = stats;
+    return out.finish(n);
+  }
+
+  ArenaSpan<size_t> counts = arena.local().span<size_t>(nBlocks);
+  ArenaSpan<BlockStats> blockStats = arena.local().span<BlockStats>(nBlocks);
+  std::atomic<size_t> next{0};
+  parallelFor(0, nBlocks, 1, [&](size_t lo, size_t hi) {
+    for (size_t k = lo; k < hi; ++k) {
+      // Bounded renders hand out blocks strictly in importance order
+      const size_t i =
+          bounded ? next.fetch_add(1, std::memory_order_relaxed) : k;
+      blockStats[i].stats = RenderStats{};
+      counts[i] = runBlock(blocks[i], blockStats[i].stats);
     }
+  });
+
+  // Slices only ever move towards the front, so copying in order is safe
+  size_t w = counts[0];
+  for (size_t i = 1; i < nBlocks; ++i) {
+    out.moveDown(blocks[i].slot, w, counts[i]);
+    w += counts[i];
+  }
+  if (d.stats) {
+    for (size_t i = 0; i < nBlocks; ++i)
+      stats += blockStats[i].stats;
+    *d.stats = stats;
   }
-  return out;
+  return out.finish(w);
+}
+
+template <typename Out>
+typename Out::Result render(const RenderDesc &desc, const MeshView &mesh,
+                            const Mat4 *models, size_t modelCount,
+                            FrameArena &arena) {
+  R3D_PROBE2(render_start, mesh.edgeCount, modelCount);
+  typename Out::Result lines =
+      projectLines<Out>(desc, mesh, models, modelCount, arena);
+  if (desc.target.data) {
+    const size_t drawn = rasterize(desc, lines);
+    if (desc.stats)
+      desc.stats->undrawn += lines.size - drawn;
+  }
+  R3D_PROBE1(render_end, lines.size);
+  return lines;
+}
+} // namespace
+
+RenderStats &RenderStats::operator+=(const RenderStats &o) {
+  processed += o.processed;
+  rejected += o.rejected;
+  nearClipped += o.nearClipped;
+  frustumCulled += o.frustumCulled;
+  hidden += o.hidden;
+  projectFailed += o.projectFailed;
+  emitted += o.emitted;
+  objectsCulled += o.objectsCulled;
+  deadlineSkipped += o.deadlineSkipped;
+  undrawn += o.undrawn;
+  return *this;
+}
+
+double RenderStats::detail() const {
+  const uint64_t total = processed + deadlineSkipped;
+  if (total == 0)
+    return 1.0;
+  const double drawn = emitted ? 1.0 - double(undrawn) / double(emitted) : 1.0;
+  return double(processed) / double(total) * drawn;
+}
+
+void printRenderStats(std::ostream &os, const RenderStats &s) {
+  os << "Edges processed:   " << s.processed << "\n"
+     << "  near rejected:   " << s.rejected << "\n"
+     << "  near clipped:    " << s.nearClipped << "\n"
+     << "  failed project:  " << s.projectFailed << "\n"
+     << "  emitted:         " << s.emitted << "\n"
+     << "Frustum culled:    " << s.frustumCulled << " edges in "
+     << s.objectsCulled << " objects\n"
+     << "Hidden:            " << s.hidden << " edges\n";
+  if (s.deadlineSkipped || s.undrawn)
+    os << "Deadline:          " << s.deadlineSkipped << " edges skipped, "
+       << s.undrawn << " lines undrawn\n";
+}
+
+ArenaSpan<ScreenLine> renderLines(const RenderDesc &desc, MeshView mesh,
+                                  FrameArena &arena) {
+  return renderInstancedLines(desc, mesh, &desc.model, 1, arena);
+}
+
+ArenaSpan<ScreenLine> renderInstancedLines(const RenderDesc &desc,
+                                           MeshView mesh, const Mat4 *models,
+                                           size_t modelCount,
+                                           FrameArena &arena) {
+  return render<LineArray>(desc, mesh, models, modelCount, arena);
+}
+
+ScreenLines renderLineStreams(const RenderDesc &desc, MeshView mesh,
+                              FrameArena &arena) {
+  return renderInstancedLineStreams(desc, mesh, &desc.model, 1, arena);
+}
+
+ScreenLines renderInstancedLineStreams(const RenderDesc &desc, MeshView mesh,
+                                       const Mat4 *models, size_t modelCount,
+                                       FrameArena &arena) {
+  return render<LineStreams>(desc, mesh, models, modelCount, arena);
+}
+
+RenderDesc Renderer::desc(const Mat4 &view, const Mat4 &proj,
+                          float nearZ) const {
+  RenderDesc d;
+  d.width = m_width;
+  d.height = m_height;
+  d.model = m_model;
+  d.view = view;
+  d.proj = proj;
+  d.nearZ = nearZ;
+  return d;
+}
+
+std::vector<ScreenLine>
+Renderer::buildProjectedLines(const Mat4 &view, const Mat4 &proj,
+                              const Mesh &mesh, float nearZ,
+                              RenderStats *stats) const {
+  FrameArena arena;
+  RenderDesc d = desc(view, proj, nearZ);
+  d.stats = stats;
+  ArenaSpan<ScreenLine> lines = renderLines(d, mesh, arena);
+  return std::vector<ScreenLine>(lines.begin(), lines.end());
+}
+
+ArenaSpan<ScreenLine>
+Renderer::buildProjectedLines(const Mat4 &view, const Mat4 &proj,
+                              const Mesh &mesh, float nearZ, FrameArena &arena,
+                              RenderStats *stats) const {
+  RenderDesc d = desc(view, proj, nearZ);
+  d.stats = stats;
+  return renderLines(d, mesh, arena);
 }
@@ -1,6 +1,11 @@
 #pragma once
+#include "FrameArena.h"
+#include "Framebuffer.h"
 #include "Math.h"
 #include "Mesh.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
 #include <utility>
 #include <vector>
 
@@ -8,6 +13,102 @@ struct ScreenLine {
   Vec2f a, b;
 };
 
+// Lines as four coordinate streams (structure of arrays), for passes that
+// work on many lines at once. Each stream is cache-line aligned and padded
+// to a multiple of kLanes with zero-length lines at the origin, so vector
+// loops can run whole lanes without a scalar tail.
+struct ScreenLines {
+  static constexpr size_t kLanes = 16; // floats per 64-byte vector register
+
+  float *ax = nullptr, *ay = nullptr, *bx = nullptr, *by = nullptr;
+  size_t size = 0;
+
+  static size_t padded(size_t n) { return (n + kLanes - 1) / kLanes * kLanes; }
+  ScreenLine operator[](size_t i) const {
+    return {{ax[i], ay[i]}, {bx[i], by[i]}};
+  }
+  bool empty() const { return size == 0; }
+};
+
+enum class RenderMode : uint8_t {
+  AllEdges,
+  // Only creases, boundaries and non-manifold edges (Mesh::featureEdges);
+  // meshes loaded without classification draw all edges
+  FeatureEdges,
+};
+
+// Pipeline counters of one render call, in edges unless noted. Counting is
+// always on: every block of edges keeps its own counters, summed at the end.
+struct RenderStats {
+  uint64_t processed = 0;     // edges transformed
+  uint64_t rejected = 0;      // both ends behind the near plane
+  uint64_t nearClipped = 0;   // one end behind the near plane, clipped
+  uint64_t frustumCulled = 0; // in objects outside the view, never transformed
+  uint64_t hidden = 0;        // in objects hidden via RenderDesc::hiddenObjects
+  uint64_t projectFailed = 0; // an end projected to w ~ 0 or a non-finite point
+  uint64_t emitted = 0;       // lines returned
+  uint64_t objectsCulled = 0; // objects (per model) culled by the frustum
+  // Deadline-bounded calls only (RenderDesc::deadline)
+  uint64_t deadlineSkipped = 0; // edges never transformed, out of time
+  uint64_t undrawn = 0;         // lines emitted but not rasterized in time
+
+  RenderStats &operator+=(const RenderStats &o);
+  // Share of the drawable edges that reached the image: 1 unless a deadline
+  // cut the render short
+  double detail() const;
+};
+
+void printRenderStats(std::ostream &os, const RenderStats &stats);
+
+using RenderClock = std::chrono::steady_clock;
+const RenderClock::time_point kNoDeadline = RenderClock::time_point::max();
+
+// Everything a single render call depends on. renderLines() reads nothing
+// else, so any number of threads can render different views of the same
+// (shared, immutable) mesh at once, each with its own FrameArena.
+struct RenderDesc {
+  int width = 1000, height = 800; // viewport in pixels
+  Mat4 model = Mat4::identity();
+  Mat4 view = Mat4::identity();
+  Mat4 proj = Mat4::identity();
+  float nearZ = 0.05f;
+  RenderMode mode = RenderMode::AllEdges;
+  // Optional, one flag per mesh object: nonzero objects are not drawn
+  const uint8_t *hiddenObjects = nullptr;
+  // Optional output: when it has pixels, the lines are also rasterized into it
+  PixelView target;
+  // Optional output: set to the counters of the call
+  RenderStats *stats = nullptr;
+  uint8_t color[3] = {230, 230, 240};
+  // Optional time limit. Edges are then taken in order of importance
+  // (feature edges first, then objects by apparent size), transforming
+  // stops halfway through the remaining time and rasterizing at the
+  // deadline, so the lines come out in that order rather than edge order.
+  RenderClock::time_point deadline = kNoDeadline;
+};
+
+// Transforms, near-clips and projects the mesh edges into pixel-space lines,
+// in edge order (see RenderDesc::deadline for the exception). The result and
+// all scratch come from `arena` (valid until arena.reset()), so repeated
+// frames don't touch the heap.
+ArenaSpan<ScreenLine> renderLines(const RenderDesc &desc, MeshView mesh,
+                                  FrameArena &arena);
+// Same for many copies of one mesh: it is drawn once per matrix in `models`
+// (desc.model is ignored), and the lines come out grouped by copy.
+ArenaSpan<ScreenLine> renderInstancedLines(const RenderDesc &desc,
+                                           MeshView mesh, const Mat4 *models,
+                                           size_t modelCount,
+                                           FrameArena &arena);
+// The same lines written straight into coordinate streams
+ScreenLines renderLineStreams(const RenderDesc &desc, MeshView mesh,
+                              FrameArena &arena);
+ScreenLines renderInstancedLineStreams(const RenderDesc &desc, MeshView mesh,
+                                       const Mat4 *models, size_t modelCount,
+                                       FrameArena &arena);
+
+// Convenience wrapper holding a viewport and model matrix between calls.
+// Not safe to share between threads that change its settings; concurrent
+// renders should build their own RenderDesc instead.
 class Renderer {
 public:
   Renderer(int w = 1000, int h = 800) : m_width(w), m_height(h) {}
@@ -17,16 +118,21 @@ public:
   }
   void setModel(const Mat4 &m) { m_model = m; }
 
-  // Returns 2D line segments in pixel coordinates after transform+clip+project
-  std::vector<ScreenLine> buildProjectedLines(const Mat4 &view,
-                                              const Mat4 &proj,
-                                              const Mesh &mesh,
-                                              float nearZ) const;
+  RenderDesc desc(const Mat4 &view, const Mat4 &proj, float nearZ) const;
+
+  // Returns 2D line segments in pixel coordinates after transform+clip+project;
+  // `stats`, if set, receives the call's counters
+  std::vector<ScreenLine>
+  buildProjectedLines(const Mat4 &view, const Mat4 &proj, const Mesh &mesh,
+                      float nearZ, RenderStats *stats = nullptr) const;
+  // Same, but the result and all scratch come from `arena`
+  ArenaSpan<ScreenLine> buildProjectedLines(const Mat4 &view,
+                                            const Mat4 &proj,
+                                            const Mesh &mesh, float nearZ,
+                                            FrameArena &arena,
+                                            RenderStats *stats = nullptr) const;
 
 private:
   int m_width, m_height;
   Mat4 m_model = Mat4::identity();
-
-  static bool clipToNear(Vec3f &a, Vec3f &b, float nearZ);
-  bool projectToScreen(const Vec4f &clip, Vec2f &out) const;
 };
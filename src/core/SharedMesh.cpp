@@ -0,0 +1,49 @@
+#include "SharedMesh.h"
+#include "ThreadPool.h"
+#include <vector>
+
+namespace {
+// Cached per mesh under its own type
+struct MeshBounds {
+  Bounds box;
+};
+
+Bounds computeBounds(const Mesh &mesh) {
+  const size_t kGrain = 65536;
+  const size_t n = mesh.vertices.size();
+  std::vector<Bounds> parts((n + kGrain - 1) / kGrain);
+  parallelFor(0, parts.size(), 1, [&](size_t lo, size_t hi) {
+    for (size_t p = lo; p < hi; ++p) {
+      const size_t end = std::min(n, (p + 1) * kGrain);
+      for (size_t i = p * kGrain; i < end; ++i)
+        parts[p].expand(mesh.vertices[i]);
+    }
+  });
+  Bounds b;
+  for (const auto &part : parts) {
+    if (part.empty())
+      continue;
+    b.expand(part.min);
+    b.expand(part.max);
+  }
+  return b;
+}
+} // namespace
+
+MeshHandle SharedMesh::freeze(Mesh &&mesh) {
+  return MeshHandle(new SharedMesh(std::move(mesh)));
+}
+
+const Bounds &SharedMesh::bounds() const {
+  return derived<MeshBounds>([](const Mesh &m) {
+           return MeshBounds{computeBounds(m)};
+         }).box;
+}
+
+SharedMesh::Slot &SharedMesh::slotFor(std::type_index type) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto &slot = m_derived[type];
+  if (!slot)
+    slot = std::make_unique<Slot>();
+  return *slot;
+}
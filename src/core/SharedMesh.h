@@ -0,0 +1,47 @@
+#pragma once
+#include "Geometry.h"
+#include "Mesh.h"
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+class SharedMesh;
+// Read-only mesh shared by any number of threads and render contexts.
+using MeshHandle = std::shared_ptr<const SharedMesh>;
+
+// A Mesh frozen after loading. Handles are only ever const, so the geometry
+// can be read concurrently without locks or copies; it converts to
+// `const Mesh &` for the renderer and every other consumer.
+//
+// Derived data (bounds, acceleration structures, LODs, ...) is computed on
+// first use and cached on the mesh: derived<T>(make) runs `make` exactly once
+// per type T even when many threads ask at the same time, and different
+// types build concurrently.
+class SharedMesh : public Mesh {
+public:
+  static MeshHandle freeze(Mesh &&mesh);
+
+  const Bounds &bounds() const;
+
+  template <typename T, typename Make> const T &derived(Make &&make) const {
+    Slot &slot = slotFor(std::type_index(typeid(T)));
+    std::call_once(slot.once, [&] {
+      slot.value = std::make_shared<T>(make(static_cast<const Mesh &>(*this)));
+    });
+    return *static_cast<const T *>(slot.value.get());
+  }
+
+private:
+  struct Slot {
+    std::once_flag once;
+    std::shared_ptr<const void> value;
+  };
+
+  explicit SharedMesh(Mesh &&mesh) : Mesh(std::move(mesh)) {}
+  Slot &slotFor(std::type_index type) const;
+
+  mutable std::mutex m_mutex; // guards the map, not the slots' contents
+  mutable std::unordered_map<std::type_index, std::unique_ptr<Slot>> m_derived;
+};
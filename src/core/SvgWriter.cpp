@@ -0,0 +1,230 @@
+#include "SvgWriter.h"
+#include "Trace.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+// Snapped point packed as x << 32 | y, so points compare as integers
+uint64_t packPoint(uint32_t x, uint32_t y) { return uint64_t(x) << 32 | y; }
+int64_t pointX(uint64_t p) { return int64_t(p >> 32); }
+int64_t pointY(uint64_t p) { return int64_t(p & 0xffffffffu); }
+
+struct Segment {
+  uint64_t a, b; // a < b
+  bool operator<(const Segment &o) const {
+    return a != o.a ? a < o.a : b < o.b;
+  }
+  bool operator==(const Segment &o) const { return a == o.a && b == o.b; }
+};
+
+// Fixed-size output buffer in front of the file
+class StreamBuffer {
+public:
+  StreamBuffer(std::ofstream &out, size_t bytes)
+      : m_out(out), m_buf(std::max<size_t>(bytes, 256)) {}
+  ~StreamBuffer() { flush(); }
+
+  void put(char c) {
+    if (m_len == m_buf.size())
+      flush();
+    m_buf[m_len++] = c;
+  }
+  void put(const std::string &s) {
+    for (char c : s)
+      put(c);
+  }
+  void putInt(int64_t v) {
+    if (m_buf.size() - m_len < 24)
+      flush();
+    m_len = size_t(
+        std::to_chars(m_buf.data() + m_len, m_buf.data() + m_buf.size(), v)
+            .ptr -
+        m_buf.data());
+  }
+  void flush() {
+    m_out.write(m_buf.data(), std::streamsize(m_len));
+    m_written += m_len;
+    m_len = 0;
+  }
+  size_t written() const { return m_written + m_len; }
+
+private:
+  std::ofstream &m_out;
+  std::vector<char> m_buf;
+  size_t m_len = 0, m_written = 0;
+};
+
+std::string hexColor(const uint8_t rgb[3]) {
+  static const char kHex[] = "0123456789abcdef";
+  std::string s = "#";
+  for (int i = 0; i < 3; ++i) {
+    s += kHex[rgb[i] >> 4];
+    s += kHex[rgb[i] & 15];
+  }
+  return s;
+}
+
+// Either line layout: lines[i] is a ScreenLine
+template <typename Lines>
+bool writeLines(const std::string &path, int width, int height,
+                const Lines &lines, size_t count, const SvgOptions &opt,
+                SvgStats *stats) {
+  R3D_PROBE2(encode_start, "svg", count);
+  SvgStats st;
+  st.segmentsIn = count;
+  const float precision = std::max(opt.precision, 1e-3f);
+  const float minLen2 = opt.minLength * opt.minLength;
+  auto snap = [&](float v) { return uint32_t(std::lround(v / precision)); };
+
+  // 1) Clip, drop short segments, snap to the grid
+  std::vector<Segment> segs;
+  segs.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const ScreenLine line = lines[i];
+    Vec2f a = line.a, b = line.b;
+    if (!clipToViewport(a, b, float(width), float(height))) {
+      ++st.offscreen;
+      continue;
+    }
+    const float dx = b.x - a.x, dy = b.y - a.y;
+    const uint64_t pa = packPoint(snap(a.x), snap(a.y));
+    const uint64_t pb = packPoint(snap(b.x), snap(b.y));
+    if (dx * dx + dy * dy < minLen2 || pa == pb) {
+      ++st.tooShort;
+      continue;
+    }
+    segs.push_back({std::min(pa, pb), std::max(pa, pb)});
+  }
+
+  // 2) Drop duplicates
+  std::sort(segs.begin(), segs.end());
+  const size_t kept =
+      size_t(std::unique(segs.begin(), segs.end()) - segs.begin());
+  st.duplicates = segs.size() - kept;
+  segs.resize(kept);
+  st.segmentsOut = kept;
+
+  // 3) Endpoint table sorted by point: the segment ends at each point are
+  // contiguous. Entry e is end (e & 1) of segment e / 2.
+  std::vector<std::pair<uint64_t, uint32_t>> ends(2 * kept);
+  for (size_t s = 0; s < kept; ++s) {
+    ends[2 * s] = {segs[s].a, uint32_t(2 * s)};
+    ends[2 * s + 1] = {segs[s].b, uint32_t(2 * s + 1)};
+  }
+  std::sort(ends.begin(), ends.end());
+  std::vector<uint64_t> points;            // per point id
+  std::vector<uint32_t> first;             // point id -> first entry in ends
+  std::vector<uint32_t> pointOf(2 * kept); // segment end -> point id
+  for (size_t i = 0; i < ends.size(); ++i) {
+    if (i == 0 || ends[i].first != ends[i - 1].first) {
+      points.push_back(ends[i].first);
+      first.push_back(uint32_t(i));
+    }
+    pointOf[ends[i].second] = uint32_t(points.size() - 1);
+  }
+  first.push_back(uint32_t(ends.size()));
+  std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+  std::vector<uint8_t> used(kept, 0);
+
+  std::ofstream f(path, std::ios::binary);
+  if (!f) {
+    R3D_PROBE2(encode_end, "svg", false);
+    return false;
+  }
+  StreamBuffer out(f, opt.bufferBytes);
+  {
+    std::ostringstream head;
+    head << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width
+         << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << " "
+         << height << "\">\n";
+    if (opt.fillBackground)
+      head << "<rect width=\"100%\" height=\"100%\" fill=\""
+           << hexColor(opt.background) << "\"/>\n";
+    // Path data is in grid units; the group scales it back to pixels
+    head << "<g transform=\"scale(" << precision << ")\" fill=\"none\" "
+         << "stroke=\"" << hexColor(opt.stroke) << "\" stroke-width=\""
+         << opt.strokeWidth / precision
+         << "\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n";
+    out.put(head.str());
+  }
+
+  // 4) Chain: walk from a point along unused segments until stuck. Walks
+  // start at odd-degree points first, so open chains are not cut in two;
+  // what remains are closed loops. All coordinates are relative.
+  const size_t kPolylinesPerPath = 1024; // keeps each d attribute modest
+  size_t inPath = 0;
+  int64_t curX = 0, curY = 0;
+  auto putCoord = [&](int64_t dx, int64_t dy, bool first) {
+    if (!first && dx >= 0)
+      out.put(' ');
+    out.putInt(dx);
+    if (dy >= 0)
+      out.put(' ');
+    out.putInt(dy);
+  };
+  auto nextSegment = [&](uint32_t p) -> int64_t {
+    uint32_t &c = cursor[p];
+    while (c < first[p + 1] && used[ends[c].second / 2])
+      ++c;
+    return c < first[p + 1] ? int64_t(ends[c].second) : -1;
+  };
+  auto walk = [&](uint32_t p) {
+    if (inPath == 0) {
+      out.put("<path d=\"");
+      curX = curY = 0; // a path's first moveto is absolute
+    }
+    out.put('m');
+    putCoord(pointX(points[p]) - curX, pointY(points[p]) - curY, true);
+    curX = pointX(points[p]);
+    curY = pointY(points[p]);
+    for (int64_t e; (e = nextSegment(p)) >= 0;) {
+      used[size_t(e) / 2] = 1;
+      p = pointOf[size_t(e) ^ 1];
+      const int64_t x = pointX(points[p]), y = pointY(points[p]);
+      putCoord(x - curX, y - curY, false);
+      curX = x;
+      curY = y;
+    }
+    ++st.polylines;
+    if (++inPath == kPolylinesPerPath) {
+      out.put("\"/>\n");
+      inPath = 0;
+    }
+  };
+  for (int pass = 0; pass < 2; ++pass)
+    for (uint32_t p = 0; p < uint32_t(points.size()); ++p) {
+      if (pass == 0 && (first[p + 1] - first[p]) % 2 == 0)
+        continue;
+      while (nextSegment(p) >= 0)
+        walk(p);
+    }
+  if (inPath > 0)
+    out.put("\"/>\n");
+  out.put("</g>\n</svg>\n");
+  out.flush();
+
+  st.bytes = out.written();
+  const bool ok = f.good();
+  if (stats)
+    *stats = st;
+  R3D_PROBE2(encode_end, "svg", ok);
+  return ok;
+}
+} // namespace
+
+bool writeSVG(const std::string &path, int width, int height,
+              const ScreenLine *lines, size_t count, const SvgOptions &opt,
+              SvgStats *stats) {
+  return writeLines(path, width, height, lines, count, opt, stats);
+}
+
+bool writeSVG(const std::string &path, int width, int height,
+              const ScreenLines &lines, const SvgOptions &opt,
+              SvgStats *stats) {
+  return writeLines(path, width, height, lines, lines.size, opt, stats);
+}
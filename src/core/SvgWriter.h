@@ -0,0 +1,39 @@
+#pragma once
+#include "Renderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct SvgOptions {
+  // Endpoints snap to this grid (pixels); coordinates are written as
+  // integers in these units, so it sets both precision and file size
+  float precision = 0.1f;
+  float minLength = 0.5f; // shorter segments (pixels) are dropped
+  float strokeWidth = 1.0f;
+  uint8_t stroke[3] = {0, 0, 0};
+  bool fillBackground = false;
+  uint8_t background[3] = {255, 255, 255};
+  size_t bufferBytes = size_t(64) << 10; // output is flushed in these blocks
+};
+
+struct SvgStats {
+  size_t segmentsIn = 0;
+  size_t offscreen = 0;  // wholly outside the viewport
+  size_t tooShort = 0;   // under minLength after clipping
+  size_t duplicates = 0; // same endpoints as another segment once snapped
+  size_t segmentsOut = 0;
+  size_t polylines = 0;
+  size_t bytes = 0; // file size
+};
+
+// Writes lines (pixel coordinates, as from renderLines()) as an SVG of
+// width x height pixels. Segments are clipped to the viewport, snapped to
+// the precision grid, filtered and chained into polylines through shared
+// endpoints; the polylines stream to disk as compact relative path data
+// through a buffer of opt.bufferBytes. Returns false on I/O errors.
+bool writeSVG(const std::string &path, int width, int height,
+              const ScreenLine *lines, size_t count,
+              const SvgOptions &opt = SvgOptions{}, SvgStats *stats = nullptr);
+bool writeSVG(const std::string &path, int width, int height,
+              const ScreenLines &lines, const SvgOptions &opt = SvgOptions{},
+              SvgStats *stats = nullptr);
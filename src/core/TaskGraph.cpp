@@ -0,0 +1,62 @@
+#include "TaskGraph.h"
+
+TaskGraph::NodeId TaskGraph::add(std::function<void()> fn,
+                                 const NodeId *depBegin, const NodeId *depEnd) {
+  NodeId id;
+  bool ready;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    id = m_nodes.size();
+    m_nodes.emplace_back();
+    Node &node = m_nodes.back();
+    node.fn = std::move(fn);
+    for (const NodeId *d = depBegin; d != depEnd; ++d) {
+      Node &dep = m_nodes[*d];
+      if (!dep.finished) {
+        dep.successors.push_back(id);
+        ++node.waiting;
+      }
+    }
+    ready = node.waiting == 0;
+  }
+  if (ready)
+    launch(id);
+  return id;
+}
+
+void TaskGraph::launch(NodeId id) {
+  m_group.run([this, id] {
+    std::function<void()> fn;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      fn = std::move(m_nodes[id].fn);
+    }
+    struct Finish {
+      TaskGraph *g;
+      NodeId id;
+      // Runs on success and on exception so dependants are never stranded
+      ~Finish() {
+        std::vector<NodeId> ready;
+        {
+          std::lock_guard<std::mutex> lk(g->m_mutex);
+          Node &node = g->m_nodes[id];
+          node.finished = true;
+          for (NodeId s : node.successors)
+            if (--g->m_nodes[s].waiting == 0)
+              ready.push_back(s);
+          node.successors.clear();
+        }
+        for (NodeId s : ready)
+          g->launch(s);
+      }
+    } finish{this, id};
+    if (m_failed.load(std::memory_order_relaxed))
+      return;
+    try {
+      fn();
+    } catch (...) {
+      m_failed.store(true, std::memory_order_relaxed);
+      throw;
+    }
+  });
+}
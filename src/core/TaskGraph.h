@@ -0,0 +1,54 @@
+#pragma once
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+// Dependency graph of tasks on a ThreadPool. A node starts as soon as all of
+// its dependencies have finished; nodes may be added while the graph is
+// already running (e.g. one parse node per chunk as a reader produces them).
+// If a node throws, nodes that have not started yet are skipped and wait()
+// rethrows the exception.
+class TaskGraph {
+public:
+  using NodeId = size_t;
+
+  explicit TaskGraph(ThreadPool &pool = ThreadPool::shared()) : m_group(pool) {}
+  ~TaskGraph() = default; // m_group waits for running nodes
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph &operator=(const TaskGraph &) = delete;
+
+  NodeId add(std::function<void()> fn, std::initializer_list<NodeId> deps = {}) {
+    return add(std::move(fn), deps.begin(), deps.end());
+  }
+  NodeId add(std::function<void()> fn, const std::vector<NodeId> &deps) {
+    return add(std::move(fn), deps.data(), deps.data() + deps.size());
+  }
+
+  // Blocks (running ready nodes) until every node added so far has finished.
+  void wait() { m_group.wait(); }
+  // Runs one ready node on the calling thread; false if none is queued.
+  bool runOne() { return m_group.runOne(); }
+  bool failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+private:
+  struct Node {
+    std::function<void()> fn;
+    int waiting = 0; // unfinished dependencies
+    bool finished = false;
+    std::vector<NodeId> successors;
+  };
+
+  NodeId add(std::function<void()> fn, const NodeId *depBegin,
+             const NodeId *depEnd);
+  void launch(NodeId id);
+
+  std::mutex m_mutex;
+  std::deque<Node> m_nodes; // deque: references stay valid while growing
+  std::atomic<bool> m_failed{false};
+  TaskGroup m_group;
+};
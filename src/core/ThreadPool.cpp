@@ -0,0 +1,200 @@
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// Identifies the pool and worker index of the current thread.
+thread_local const ThreadPool *tlsPool = nullptr;
+thread_local int tlsWorker = -1;
+
+std::mutex sharedMutex;
+ThreadPool::Options sharedOptions;
+bool sharedCreated = false;
+
+void pinToCpu(std::thread &t, unsigned cpu) {
+#ifdef __linux__
+  unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % ncpu, &set);
+  pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+  (void)t;
+  (void)cpu;
+#endif
+}
+} // namespace
+
+ThreadPool::ThreadPool(Options opt) {
+  unsigned n = opt.threads;
+  if (n == 0) {
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    n = hw > 2 + opt.reserveThreads ? hw - 1 - opt.reserveThreads : 1;
+  }
+  for (unsigned i = 0; i <= n; ++i)
+    m_queues.push_back(std::make_unique<Queue>());
+  m_workers.reserve(n);
+  for (unsigned i = 0; i < n; ++i) {
+    m_workers.emplace_back([this, i] { workerLoop(i); });
+    if (opt.pinThreads)
+      pinToCpu(m_workers.back(), i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lk(m_sleepMutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &t : m_workers)
+    t.join();
+  // Without workers, anything still queued runs here
+  for (std::function<void()> task; pop(-1, task); task = nullptr)
+    task();
+}
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool *pool = [] {
+    std::lock_guard<std::mutex> lk(sharedMutex);
+    Options opt = sharedOptions;
+    if (const char *env = std::getenv("R3D_THREADS")) {
+      int n = std::atoi(env);
+      if (n > 0)
+        opt.threads = unsigned(n);
+    }
+    sharedCreated = true;
+    // Leaked on purpose: tasks may still run during static destruction
+    return new ThreadPool(opt);
+  }();
+  return *pool;
+}
+
+bool ThreadPool::configureShared(const Options &opt) {
+  std::lock_guard<std::mutex> lk(sharedMutex);
+  if (sharedCreated)
+    return false;
+  sharedOptions = opt;
+  return true;
+}
+
+int ThreadPool::currentWorker() const {
+  return tlsPool == this ? tlsWorker : -1;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  // Workers push to their own deque; other threads round-robin over all
+  int self = currentWorker();
+  size_t qi = self >= 0
+                  ? size_t(self)
+                  : m_nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                        m_queues.size();
+  m_queued.fetch_add(1, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lk(m_queues[qi]->m);
+    m_queues[qi]->tasks.push_back(std::move(task));
+  }
+  {
+    // Pairs with the predicate check in workerLoop so wake-ups aren't lost
+    std::lock_guard<std::mutex> lk(m_sleepMutex);
+  }
+  m_wake.notify_one();
+}
+
+bool ThreadPool::pop(int self, std::function<void()> &task) {
+  if (m_queued.load(std::memory_order_acquire) == 0)
+    return false;
+  const size_t nq = m_queues.size();
+  if (self >= 0) {
+    Queue &own = *m_queues[size_t(self)];
+    std::lock_guard<std::mutex> lk(own.m);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  const size_t start = self >= 0 ? size_t(self) + 1 : 0;
+  for (size_t k = 0; k < nq; ++k) {
+    Queue &q = *m_queues[(start + k) % nq];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+  tlsPool = this;
+  tlsWorker = int(index);
+  std::function<void()> task;
+  for (;;) {
+    if (pop(int(index), task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(m_sleepMutex);
+    m_wake.wait(lk, [this] {
+      return m_stop || m_queued.load(std::memory_order_acquire) > 0;
+    });
+    if (m_stop && m_queued.load(std::memory_order_acquire) == 0)
+      return;
+  }
+}
+
+void TaskGroup::finishOne() {
+  // Decrement under the lock: once a waiter has seen zero and re-taken the
+  // lock, no task touches this group again and it may be destroyed.
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    m_done.notify_all();
+}
+
+bool TaskGroup::Queue::runOne() {
+  std::function<void()> task;
+  {
+    std::lock_guard<std::mutex> lk(m);
+    if (tasks.empty())
+      return false;
+    task = std::move(tasks.front());
+    tasks.pop_front();
+  }
+  task();
+  return true;
+}
+
+void TaskGroup::waitNoThrow() {
+  while (!done()) {
+    if (runOne())
+      continue;
+    // The rest are running elsewhere: sleep briefly, then look for tasks
+    // they added to the group
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_done.wait_for(lk, std::chrono::microseconds(200),
+                    [this] { return done(); });
+  }
+  std::lock_guard<std::mutex> lk(m_mutex);
+}
+
+void TaskGroup::wait() {
+  waitNoThrow();
+  std::exception_ptr err;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    std::swap(err, m_error);
+  }
+  if (err)
+    std::rethrow_exception(err);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool shared by every parallel stage in core. Each worker owns
+// a deque: it pops its own tasks LIFO and steals from the others FIFO.
+// Threads that wait on a TaskGroup (wait, parallelFor) run that group's
+// queued tasks meanwhile, so nested parallelism never blocks or spawns extra
+// threads; plain submit()ted tasks only ever run on workers.
+class ThreadPool {
+public:
+  struct Options {
+    // Workers; 0 = hardware threads - 1 - reserve, but at least one so
+    // background tasks (async loads, sprites) always make progress.
+    unsigned threads = 0;
+    unsigned reserveThreads = 0; // hardware threads left to the host app
+    bool pinThreads = false;     // pin worker i to CPU i (Linux only)
+  };
+
+  explicit ThreadPool(Options opt);
+  ThreadPool() : ThreadPool(Options{}) {}
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Process-wide pool. configureShared() only has an effect before the first
+  // shared() call; the R3D_THREADS environment variable overrides `threads`.
+  static ThreadPool &shared();
+  static bool configureShared(const Options &opt);
+
+  // Number of worker threads (the calling thread participates on top).
+  unsigned size() const { return (unsigned)m_workers.size(); }
+
+  void submit(std::function<void()> task);
+  // Worker index of the calling thread in this pool, or -1.
+  int currentWorker() const;
+
+private:
+  struct Queue {
+    std::mutex m;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool pop(int self, std::function<void()> &task);
+  void workerLoop(unsigned index);
+
+  std::vector<std::unique_ptr<Queue>> m_queues; // one per worker + 1 injection
+  std::vector<std::thread> m_workers;
+  std::atomic<size_t> m_queued{0};
+  std::atomic<unsigned> m_nextQueue{0};
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+};
+
+// Set of tasks that can be waited for together. wait() helps run the group's
+// own tasks, never unrelated ones (a long load on a GUI thread, or code the
+// waiter is itself inside of), and rethrows the first exception thrown by a
+// task.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &pool = ThreadPool::shared()) : m_pool(pool) {}
+  ~TaskGroup() { waitNoThrow(); }
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  template <typename F> void run(F &&fn) {
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lk(m_queue->m);
+      m_queue->tasks.emplace_back([this, fn = std::forward<F>(fn)]() mutable {
+        try {
+          fn();
+        } catch (...) {
+          std::lock_guard<std::mutex> lk(m_mutex);
+          if (!m_error)
+            m_error = std::current_exception();
+        }
+        finishOne();
+      });
+    }
+    // One token per task: whoever gets to the queue first runs the next task
+    m_pool.submit([queue = m_queue] { queue->runOne(); });
+  }
+
+  // Runs one of the group's queued tasks on the calling thread; false if
+  // none is queued.
+  bool runOne() { return m_queue->runOne(); }
+  void wait();
+  bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+  ThreadPool &pool() const { return m_pool; }
+
+private:
+  // Shared with the pool's tokens, which may outlive the group
+  struct Queue {
+    std::mutex m;
+    std::deque<std::function<void()>> tasks;
+    bool runOne();
+  };
+
+  void finishOne();
+  void waitNoThrow();
+
+  ThreadPool &m_pool;
+  std::shared_ptr<Queue> m_queue = std::make_shared<Queue>();
+  std::atomic<int> m_pending{0};
+  std::mutex m_mutex;
+  std::condition_variable m_done;
+  std::exception_ptr m_error;
+};
+
+// Calls fn(lo, hi) over [begin, end) split into chunks of at least `grain`
+// items. The calling thread takes the first chunk and then helps with the
+// rest; ranges no larger than `grain` run inline.
+template <typename F>
+void parallelFor(size_t begin, size_t end, size_t grain, F &&fn,
+                 ThreadPool &pool = ThreadPool::shared()) {
+  if (end <= begin)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  const size_t n = end - begin;
+  if (n <= grain || pool.size() == 0) {
+    fn(begin, end);
+    return;
+  }
+  // A few chunks per thread keeps stealing effective without flooding queues
+  const size_t maxChunks = size_t(pool.size() + 1) * 4;
+  const size_t chunks = std::min((n + grain - 1) / grain, maxChunks);
+  const size_t step = (n + chunks - 1) / chunks;
+
+  TaskGroup group(pool);
+  for (size_t lo = begin + step; lo < end; lo += step) {
+    const size_t hi = std::min(lo + step, end);
+    group.run([&fn, lo, hi] { fn(lo, hi); });
+  }
+  fn(begin, std::min(begin + step, end));
+  group.wait();
+}
@@ -0,0 +1,96 @@
+#include "TileCache.h"
+
+namespace {
+std::string tileName(const TileKey &key) {
+  return std::to_string(key.z) + "/" + std::to_string(key.x) + "/" +
+         std::to_string(key.y) + ".png";
+}
+} // namespace
+
+TileCache::TileCache(Options opt) : m_opt(std::move(opt)) {
+  if (!m_opt.directory.empty())
+    m_disk.reset(new DiskCache(m_opt.directory, m_opt.diskBytes));
+}
+
+TileBytes TileCache::fetch(const TileKey &key,
+                           const std::function<std::vector<uint8_t>()> &make) {
+  std::vector<uint8_t> bytes;
+  if (m_disk && m_disk->read(tileName(key), bytes) && !bytes.empty()) {
+    ++m_diskHits;
+    return std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+  }
+  ++m_renders;
+  TileBytes tile = std::make_shared<const std::vector<uint8_t>>(make());
+  if (m_disk)
+    m_disk->write(tileName(key), tile->data(), tile->size());
+  return tile;
+}
+
+TileBytes TileCache::get(const TileKey &key,
+                         const std::function<std::vector<uint8_t>()> &make) {
+  const uint64_t packed = key.packed();
+  std::shared_ptr<Slot> slot;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_slots.find(packed);
+    if (it != m_slots.end()) {
+      slot = it->second;
+      m_lru.splice(m_lru.begin(), m_lru, slot->lru);
+    } else {
+      slot = std::make_shared<Slot>();
+      m_lru.push_front(packed);
+      slot->lru = m_lru.begin();
+      m_slots.emplace(packed, slot);
+    }
+  }
+
+  bool filled = false;
+  std::call_once(slot->once, [&] {
+    slot->value = fetch(key, make);
+    filled = true;
+  });
+  if (!filled) {
+    ++m_memoryHits;
+    return slot->value;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_slots.find(packed);
+  if (it == m_slots.end() || it->second != slot)
+    return slot->value; // evicted while rendering
+  slot->bytes = slot->value->size();
+  m_bytes += slot->bytes;
+  // Least recently used first; slots still rendering hold no bytes yet
+  for (auto lru = m_lru.end(); m_bytes > m_opt.memoryBytes &&
+                               lru != m_lru.begin();) {
+    --lru;
+    auto victim = m_slots.find(*lru);
+    if (victim->second == slot || victim->second->bytes == 0)
+      continue;
+    m_bytes -= victim->second->bytes;
+    m_slots.erase(victim);
+    lru = m_lru.erase(lru);
+    ++m_evictions;
+  }
+  return slot->value;
+}
+
+TileCache::Stats TileCache::stats() const {
+  Stats s;
+  s.memoryHits = m_memoryHits;
+  s.diskHits = m_diskHits;
+  s.renders = m_renders;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    s.evictions = m_evictions;
+    s.memoryTiles = m_slots.size();
+    s.memoryBytes = m_bytes;
+  }
+  if (m_disk) {
+    const DiskCache::Stats disk = m_disk->stats();
+    s.diskEvictions = disk.evictions;
+    s.diskTiles = disk.files;
+    s.diskBytes = disk.bytes;
+  }
+  return s;
+}
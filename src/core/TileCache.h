@@ -0,0 +1,68 @@
+#pragma once
+#include "DiskCache.h"
+#include "TileIndex.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An encoded tile, shared by the cache and every response sending it.
+using TileBytes = std::shared_ptr<const std::vector<uint8_t>>;
+
+// Two-level LRU cache of encoded tiles: memory in front of an optional
+// directory of z/x/y.png files. Concurrent requests for a tile that is not
+// cached wait for one render instead of each starting their own.
+class TileCache {
+public:
+  struct Options {
+    size_t memoryBytes = size_t(256) << 20;
+    std::string directory; // empty: memory only
+    size_t diskBytes = size_t(1) << 30;
+  };
+
+  struct Stats {
+    uint64_t memoryHits = 0, diskHits = 0, renders = 0;
+    uint64_t evictions = 0, diskEvictions = 0;
+    size_t memoryTiles = 0, memoryBytes = 0;
+    size_t diskTiles = 0, diskBytes = 0;
+  };
+
+  // Picks up the tiles a previous run left in `directory`.
+  explicit TileCache(Options opt);
+  TileCache(const TileCache &) = delete;
+  TileCache &operator=(const TileCache &) = delete;
+
+  // The encoded tile: from memory, else from disk, else from make().
+  TileBytes get(const TileKey &key,
+                const std::function<std::vector<uint8_t>()> &make);
+
+  Stats stats() const;
+
+private:
+  struct Slot {
+    std::once_flag once;
+    TileBytes value;
+    size_t bytes = 0; // 0 until value is set and counted
+    std::list<uint64_t>::iterator lru;
+  };
+  TileBytes fetch(const TileKey &key,
+                  const std::function<std::vector<uint8_t>()> &make);
+
+  Options m_opt;
+
+  mutable std::mutex m_mutex; // guards the memory map, not the slots' values
+  std::unordered_map<uint64_t, std::shared_ptr<Slot>> m_slots;
+  std::list<uint64_t> m_lru; // most recently used first
+  size_t m_bytes = 0;
+  uint64_t m_evictions = 0;
+
+  std::unique_ptr<DiskCache> m_disk; // null without a directory
+
+  std::atomic<uint64_t> m_memoryHits{0}, m_diskHits{0}, m_renders{0};
+};
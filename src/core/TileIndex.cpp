@@ -0,0 +1,173 @@
+#include "TileIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Calls fn(cell) for every cell of a grid x grid tiling of [0, 1]^2 that
+// segment ab passes through, walking from cell to cell (Amanatides-Woo)
+template <typename F> void forEachCell(Vec2f a, Vec2f b, int grid, F &&fn) {
+  const double inf = std::numeric_limits<double>::infinity();
+  const double px = double(a.x) * grid, py = double(a.y) * grid;
+  const double dx = double(b.x) * grid - px, dy = double(b.y) * grid - py;
+  auto cellOf = [grid](double v) {
+    return std::min(std::max(int(std::floor(v)), 0), grid - 1);
+  };
+  int cx = cellOf(px), cy = cellOf(py);
+  const int ex = cellOf(px + dx), ey = cellOf(py + dy);
+  const int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+  const double stepX = dx != 0 ? std::abs(1.0 / dx) : inf;
+  const double stepY = dy != 0 ? std::abs(1.0 / dy) : inf;
+  double tx = dx > 0 ? (cx + 1 - px) / dx : dx < 0 ? (px - cx) / -dx : inf;
+  double ty = dy > 0 ? (cy + 1 - py) / dy : dy < 0 ? (py - cy) / -dy : inf;
+  // Rounding can't make the walk run away: it takes at most this many steps
+  int steps = std::abs(ex - cx) + std::abs(ey - cy);
+  fn(size_t(cy) * size_t(grid) + size_t(cx));
+  while (steps-- > 0 && (cx != ex || cy != ey)) {
+    if (tx < ty) {
+      cx += sx;
+      tx += stepX;
+    } else {
+      cy += sy;
+      ty += stepY;
+    }
+    if (cx < 0 || cy < 0 || cx >= grid || cy >= grid)
+      break;
+    fn(size_t(cy) * size_t(grid) + size_t(cx));
+  }
+}
+
+// Shortens a segment whose pixel coordinates don't fit an int to the part
+// within +-2^29 of the tile; lines that fit are left exact
+bool clipFar(double &x0, double &y0, double &x1, double &y1) {
+  const double kFar = double(1 << 29);
+  if (std::max({std::abs(x0), std::abs(y0), std::abs(x1), std::abs(y1)}) <
+      kFar)
+    return true;
+  const double dx = x1 - x0, dy = y1 - y0;
+  const double p[4] = {-dx, dx, -dy, dy};
+  const double q[4] = {x0 + kFar, kFar - x0, y0 + kFar, kFar - y0};
+  double t0 = 0, t1 = 1;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0) {
+      if (q[i] < 0)
+        return false;
+      continue;
+    }
+    const double t = q[i] / p[i];
+    if (p[i] < 0)
+      t0 = std::max(t0, t);
+    else
+      t1 = std::min(t1, t);
+    if (t0 > t1)
+      return false;
+  }
+  x1 = x0 + t1 * dx;
+  y1 = y0 + t1 * dy;
+  x0 += t0 * dx;
+  y0 += t0 * dy;
+  return true;
+}
+
+// The part of a unit-coordinate line inside the image, with a margin for
+// lines that round onto its edge pixels; false if it misses
+const float kMargin = 1.f / 4096;
+bool clipToImage(ScreenLine &l) {
+  Vec2f a{l.a.x + kMargin, l.a.y + kMargin};
+  Vec2f b{l.b.x + kMargin, l.b.y + kMargin};
+  if (!clipToViewport(a, b, 1 + 2 * kMargin, 1 + 2 * kMargin))
+    return false;
+  l.a = {a.x - kMargin, a.y - kMargin};
+  l.b = {b.x - kMargin, b.y - kMargin};
+  return true;
+}
+} // namespace
+
+TileIndex::TileIndex(const RenderDesc &desc, MeshView mesh,
+                     FrameArena &arena) {
+  RenderDesc d = desc;
+  d.width = d.height = 1;
+  d.target = PixelView{};
+  ArenaSpan<ScreenLine> lines = renderLines(d, mesh, arena);
+  // Kept unclipped, so tiles rasterize exactly like a single large image;
+  // only the grid walk uses the clipped part
+  m_lines.reserve(lines.size);
+  for (ScreenLine l : lines) {
+    ScreenLine c = l;
+    if (clipToImage(c))
+      m_lines.push_back(l);
+  }
+
+  while (size_t(m_grid) * size_t(m_grid) * 4 < m_lines.size() &&
+         m_grid < 1024)
+    m_grid *= 2;
+  const size_t cells = size_t(m_grid) * size_t(m_grid);
+
+  // Count per cell, then fill (CSR)
+  m_cellStart.assign(cells + 1, 0);
+  for (ScreenLine l : m_lines) {
+    clipToImage(l);
+    forEachCell(l.a, l.b, m_grid, [&](size_t c) { ++m_cellStart[c + 1]; });
+  }
+  for (size_t c = 0; c < cells; ++c)
+    m_cellStart[c + 1] += m_cellStart[c];
+  m_ids.resize(m_cellStart[cells]);
+  std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+  for (size_t i = 0; i < m_lines.size(); ++i) {
+    ScreenLine l = m_lines[i];
+    clipToImage(l);
+    forEachCell(l.a, l.b, m_grid,
+                [&](size_t c) { m_ids[fill[c]++] = uint32_t(i); });
+  }
+}
+
+size_t TileIndex::bytes() const {
+  return m_lines.capacity() * sizeof(ScreenLine) +
+         (m_cellStart.capacity() + m_ids.capacity()) * sizeof(uint32_t);
+}
+
+size_t TileIndex::render(const TileKey &key, const PixelView &target,
+                         const uint8_t color[3],
+                         std::vector<uint32_t> &scratch) const {
+  const double tiles = double(int64_t(1) << key.z);
+  const double scale = tiles * target.w; // pixels per unit at this level
+  const double ox = key.x * double(target.w), oy = key.y * double(target.w);
+  auto draw = [&](const ScreenLine &l) {
+    double x0 = l.a.x * scale - ox, y0 = l.a.y * scale - oy;
+    double x1 = l.b.x * scale - ox, y1 = l.b.y * scale - oy;
+    if (clipFar(x0, y0, x1, y1))
+      drawLine(target, int(std::lround(x0)), int(std::lround(y0)),
+               int(std::lround(x1)), int(std::lround(y1)), color[0], color[1],
+               color[2]);
+  };
+
+  // Cells under the tile, plus a pixel of margin for endpoint rounding
+  const double pad = 1.0 / scale;
+  auto cellOf = [&](double v) {
+    return std::min(std::max(int(std::floor(v * m_grid)), 0), m_grid - 1);
+  };
+  const int cx0 = cellOf(key.x / tiles - pad);
+  const int cx1 = cellOf((key.x + 1) / tiles + pad);
+  const int cy0 = cellOf(key.y / tiles - pad);
+  const int cy1 = cellOf((key.y + 1) / tiles + pad);
+  const size_t covered = size_t(cx1 - cx0 + 1) * size_t(cy1 - cy0 + 1);
+  // Coarse tiles see most of the image: skip the dedup and draw everything
+  if (covered * 16 >= size_t(m_grid) * size_t(m_grid)) {
+    for (const ScreenLine &l : m_lines)
+      draw(l);
+    return m_lines.size();
+  }
+
+  // A line crossing several cells is listed in each of them
+  scratch.clear();
+  for (int cy = cy0; cy <= cy1; ++cy) {
+    const size_t row = size_t(cy) * size_t(m_grid);
+    scratch.insert(scratch.end(), m_ids.begin() + m_cellStart[row + cx0],
+                   m_ids.begin() + m_cellStart[row + cx1 + 1]);
+  }
+  std::sort(scratch.begin(), scratch.end());
+  scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+  for (uint32_t id : scratch)
+    draw(m_lines[id]);
+  return scratch.size();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Address of a tile in a zoom pyramid: level z is 2^z x 2^z tiles.
+struct TileKey {
+  int z = 0, x = 0, y = 0;
+
+  bool valid(int maxZoom) const {
+    return z >= 0 && z <= maxZoom && x >= 0 && y >= 0 && x < (1 << z) &&
+           y < (1 << z);
+  }
+  uint64_t packed() const {
+    return uint64_t(z) << 58 | uint64_t(x) << 29 | uint64_t(y);
+  }
+};
+
+// The lines of one fixed view, projected once, in unit image coordinates
+// ([0, 1]^2 is the whole image) and bucketed into a uniform grid. A tile
+// then only visits the lines of the cells it overlaps, so a deep-zoom tile
+// costs about as much as the detail inside it, not the mesh size.
+class TileIndex {
+public:
+  // Projects the mesh with renderLines() (the viewport size in `desc` is
+  // ignored: the image is square), clips the lines to the image and builds
+  // the grid, about four lines per cell.
+  TileIndex(const RenderDesc &desc, MeshView mesh, FrameArena &arena);
+
+  size_t lineCount() const { return m_lines.size(); }
+  int gridSize() const { return m_grid; }
+  size_t bytes() const;
+
+  // Draws `key` into `target` (a square tile of any size) and returns the
+  // lines drawn. `scratch` keeps candidate ids between calls.
+  size_t render(const TileKey &key, const PixelView &target,
+                const uint8_t color[3], std::vector<uint32_t> &scratch) const;
+
+private:
+  std::vector<ScreenLine> m_lines;
+  int m_grid = 1;
+  std::vector<uint32_t> m_cellStart; // m_grid^2 + 1 offsets into m_ids
+  std::vector<uint32_t> m_ids;       // line ids, cell by cell
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// USDT (user-level statically defined tracing) probes, provider "r3d", for
+// bpftrace/perf on production builds. Built with R3D_USDT (CMake
+// ENABLE_USDT, when <sys/sdt.h> is found) every probe is a single nop plus
+// a note in the ELF file until a tracer attaches; otherwise they compile to
+// nothing and their arguments are not evaluated.
+//
+//   load_start(path, bytes)        load_end(path, vertices, edges, ok)
+//   dedup_start(stage, edges)      dedup_end(stage, edges)
+//   render_start(edges, models)    render_end(lines)
+//   raster_start(lines)            raster_end(lines)
+//   encode_start(format, bytes)    encode_end(format, ok)
+//   frame_start()                  frame_end(lines, ns)
+//
+// dedup stage is 0 within one chunk and 1 against the merged mesh. Pairs
+// fire on the same thread, so `@[tid]` keys latency measurements, e.g.
+//   bpftrace -e 'usdt:./render-cli:r3d:render_start { @t[tid] = nsecs; }
+//     usdt:./render-cli:r3d:render_end /@t[tid]/ {
+//       @us = hist((nsecs - @t[tid]) / 1000); delete(@t[tid]); }'
+
+#if defined(R3D_USDT) && R3D_USDT
+#include <sys/sdt.h>
+#define R3D_PROBE(name) DTRACE_PROBE(r3d, name)
+#define R3D_PROBE1(name, a) DTRACE_PROBE1(r3d, name, a)
+#define R3D_PROBE2(name, a, b) DTRACE_PROBE2(r3d, name, a, b)
+#define R3D_PROBE3(name, a, b, c) DTRACE_PROBE3(r3d, name, a, b, c)
+#define R3D_PROBE4(name, a, b, c, d) DTRACE_PROBE4(r3d, name, a, b, c, d)
+#else
+// sizeof keeps arguments "used" without evaluating them
+#define R3D_PROBE(name) ((void)0)
+#define R3D_PROBE1(name, a) ((void)sizeof(a))
+#define R3D_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define R3D_PROBE3(name, a, b, c)                                              \
+  ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#define R3D_PROBE4(name, a, b, c, d)                                           \
+  ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c), (void)sizeof(d))
+#endif